@@ -8,6 +8,14 @@ Application::Application(const char* title,
 	camera(glm::vec3(0.f, 0.f, 2.f), glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f))
 {
 	this->window = nullptr;
+	this->frameUniforms = nullptr;
+	this->textureStreamer = nullptr;
+	this->textureCache = nullptr;
+	this->textureSampler = nullptr;
+	this->materialLibrary = nullptr;
+	this->renderQueue = nullptr;
+	this->picker = nullptr;
+	this->grid = nullptr;
 	this->framebufferHeight = this->WINDOW_HEIGHT;
 	this->framebufferWidth = this->WINDOW_WIDTH;
 
@@ -18,6 +26,10 @@ Application::Application(const char* title,
 	this->drawDistance = 1000.f;
 	this->aspectRatio = static_cast<float>(framebufferWidth / framebufferHeight);
 
+	// Culling statistics
+	this->visibleMeshes = 0;
+	this->culledMeshes = 0;
+
 	// Default Time
 	this->delta = 0.f;
 	this->now = 0.f;
@@ -49,38 +61,36 @@ Application::Application(const char* title,
 
 // Destructor
 Application::~Application() {
-	glfwDestroyWindow(this->window);
-	glfwTerminate();
+	delete this->frameUniforms;
+	delete this->renderQueue;
+	delete this->picker;
+	delete this->grid;
+	// Before the textures, pending uploads still point at them
+	delete this->textureStreamer;
 
 	for (size_t i = 0; i < this->shaders.size(); i++)
 	{
 		delete this->shaders[i];
 	}
 
-	for (size_t i = 0; i < this->materials.size(); i++)
-	{
-		delete this->materials[i];
-	}
-
-	for (size_t i = 0; i < this->textures.size(); i++)
-	{
-		delete this->textures[i];
-	}
-
 	for (size_t i = 0; i < this->meshes.size(); i++)
 	{
 		delete this->meshes[i];
 	}
 
-	for (size_t i = 0; i < this->grid.size(); i++)
-	{
-		delete this->grid[i];
-	}
+	// Textures go with the cache once the materials released them
+	delete this->materialLibrary;
+	delete this->textureCache;
+	delete this->textureSampler;
 
 	for (size_t i = 0; i < this->lights.size(); i++)
 	{
 		delete this->lights[i];
 	}
+
+	// GL objects above are freed while the context is still alive
+	glfwDestroyWindow(this->window);
+	glfwTerminate();
 }
 
 
@@ -106,9 +116,10 @@ void Application::initWindow(const char* title, bool resizable) {
 	// Save framebuffer size
 	glfwGetFramebufferSize(this->window, &this->framebufferWidth, &this->framebufferHeight);
 	
-	// Keyboard and Resize callback
+	// Keyboard, Mouse and Resize callback
 	glfwSetWindowUserPointer(window, this);
 	glfwSetKeyCallback(this->window, &key_callback); 
+	glfwSetMouseButtonCallback(this->window, &mouse_button_callback);
 	glfwSetFramebufferSizeCallback(this->window, Application::framebuffer_resize_callback);
 
 	// Set Active window
@@ -140,19 +151,19 @@ void Application::initGlew() {
 // Set OPENGL Options
 void Application::initOpengl() {
 	// Perspective View
-	glEnable(GL_DEPTH_TEST);
+	this->glState.enable(GL_DEPTH_TEST);
 	
 	// Single Face Tri
-	glEnable(GL_CULL_FACE);
-	glCullFace(GL_BACK);
+	this->glState.enable(GL_CULL_FACE);
+	this->glState.cullFaceMode(GL_BACK);
 	glFrontFace(GL_CCW);
 	
 	// Blending Color Options
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	this->glState.enable(GL_BLEND);
+	this->glState.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	// Set Polygon Mode
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	this->glState.polygonMode(GL_FILL);
 
 	// Active Mouse input
 	glfwSetInputMode(this->window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -172,50 +183,63 @@ void Application::initMatrices() {
 // Initialize Shader Programs From files
 void Application::initShaders()
 {
-	this->shaders.push_back(new Shader("vertex_core.glsl", "fragment_core.glsl"));
-	this->shaders.push_back(new Shader("vertex_core.glsl", "fragment_core2.glsl"));
+	// Material block read through bindless handles when the driver allows, texture arrays otherwise
+	// Packed and float normals are told apart per vertex, one program draws every vertex format
+	std::string defines = MaterialLibrary::getShaderDefines(MaterialLibrary::isBindlessSupported());
+	this->shaders.push_back(new Shader("vertex_core.glsl", "fragment_core.glsl", "", defines));
+	this->shaders.push_back(new Shader("vertex_core.glsl", "fragment_core2.glsl", "", defines));
+
+	// Draws of every frame are sorted by state and depth, then submitted instanced
+	this->renderQueue = new RenderQueue();
+
+	// Id buffer picking, only renders when a click is pending
+	this->picker = new GpuPicker(this->framebufferWidth, this->framebufferHeight, defines);
 }
 
 // Initialize Textures From files
 void Application::initTextures()
 {
+	// Decoded in the background, textures show a placeholder until their upload
+	this->textureStreamer = new TextureStreamer();
+
+	// One trilinear sampler shared by every texture, K toggles anisotropic filtering
+	this->textureSampler = new Sampler(GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT);
+	this->textureCache = new TextureCache(this->textureStreamer, this->textureSampler);
+
 	// IMPORTANT : First load the texture and then the speculat map of it
-	this->textures.push_back(new Texture("Images/wood.jpg", GL_TEXTURE_2D));
-	this->textures.push_back(new Texture("Images/woods.jpg", GL_TEXTURE_2D));
-	this->textures.push_back(new Texture("Images/blue.jpg", GL_TEXTURE_2D));
-	this->textures.push_back(new Texture("Images/blue.jpg", GL_TEXTURE_2D));
-	this->textures.push_back(new Texture("Images/metal.jpg", GL_TEXTURE_2D));
-	this->textures.push_back(new Texture("Images/metalS.jpg", GL_TEXTURE_2D));
+	this->textureFiles.push_back("Images/wood.jpg");
+	this->textureFiles.push_back("Images/woods.jpg");
+	this->textureFiles.push_back("Images/blue.jpg");
+	this->textureFiles.push_back("Images/blue.jpg");
+	this->textureFiles.push_back("Images/metal.jpg");
+	this->textureFiles.push_back("Images/metalS.jpg");
 }
 
 // Initialize Materials
 void Application::initMaterials()
 {
+	// Images are packed into shared texture arrays or get bindless handles once streamed in
+	this->materialLibrary = new MaterialLibrary(this->textureSampler);
+	std::cout << "Materials use " << (this->materialLibrary->isBindless() ? "bindless textures" : "texture arrays") << std::endl;
+
 	/* Inputs of Material
 	Ambient Light Intensity, Diffuse Light Intensity, Specular Light Intensity,
-	Diffuse Texture Unit, Specular Texture Unit */
-	this->materials.push_back(new Material(glm::vec3(0.1f), glm::vec3(1.0f), glm::vec3(0.5f), 0, 1));
-	this->materials.push_back(new Material(glm::vec3(0.1f), glm::vec3(1.0f), glm::vec3(0.5f), 2, 3));
+	Diffuse Texture, Specular Texture */
+	for (size_t i = 0; i + 1 < this->textureFiles.size(); i += 2) {
+		this->materialLibrary->create(glm::vec3(0.1f), glm::vec3(1.0f), glm::vec3(0.5f),
+			this->textureCache->acquire(this->textureFiles[i]), this->textureCache->acquire(this->textureFiles[i + 1], TEXTURE_SPECULAR));
+	}
 }
 
 // Initialize Meshes and Grid
 void Application::initMeshes()
 {
-	Quad quad = Quad();
 	/* Input of Mesh
-	Primitive, Diffuse Texture, Specular Texture, Material*/
-	this->meshes.push_back(new Mesh(&quad, this->textures[2], this->textures[3], this->materials[0]));
+	Geometry, Material*/
+	this->addMesh(new Mesh(&this->transforms, this->geometries.acquire<Quad>("Quad"), this->materialLibrary->get(1)));
 	
 	// Initialize Floor Grid
-	int i;
-	for (i = 0; i < 30; i++) {
-		Line line = Line(glm::vec3((i - 15) * 0.5f, -1.f, -7.5f), glm::vec3((i - 15) * 0.5f, -1.f, 7.5f));
-		this->grid.push_back(new Mesh(&line, this->textures[2], this->textures[3], this->materials[0]));
-	}
-	for (i = 0; i < 30; i++) {
-		Line line = Line(glm::vec3(-7.5f, -1.f, (i - 15) * 0.5f), glm::vec3(7.5f, -1.f, (i - 15) * 0.5f));
-		this->grid.push_back(new Mesh(&line, this->textures[2], this->textures[3], this->materials[0]));
-	}
+	this->grid = new Grid();
 }
 
 // Initialize Light
@@ -228,13 +252,14 @@ void Application::initLights()
 // Initialize Uniforms
 void Application::initUniforms()
 {
-	// Send Uniforms to default shader program
-	int j;
-	for (j = 0; j < shaders.size(); j++) {
-		this->shaders[j]->setMat4fv(this->ViewMatrix, "ViewMatrix");
-		this->shaders[j]->setMat4fv(this->ProjectionMatrix, "ProjectionMatrix");
-		this->shaders[j]->setVec3f(*this->lights[0], "lightPos0");
-	}
+	// Frame data block is bound once and read by every shader program
+	this->frameUniforms = new UniformBuffer(sizeof(FrameData), FRAME_DATA_BINDING);
+
+	this->frameData.ViewMatrix = this->ViewMatrix;
+	this->frameData.ProjectionMatrix = this->ProjectionMatrix;
+	this->frameData.camPos = glm::vec4(this->camera.getPosition(), 1.f);
+	this->frameData.lightPos0 = glm::vec4(*this->lights[0], 1.f);
+	this->frameUniforms->update(&this->frameData);
 }
 
 /* ################################## MAIN WHILE LOOP #################################### */
@@ -259,14 +284,51 @@ void Application::updateUniforms() {
 	
 	this->ProjectionMatrix = glm::perspective(glm::radians(this->FOV), this->aspectRatio, this->clipDistance, this->drawDistance);
 	
-	int j;
-	for (j = 0; j < shaders.size(); j++) {
-		this->shaders[j]->setMat4fv(this->ViewMatrix, "ViewMatrix");
-		this->shaders[j]->setVec3f(this->camera.getPosition(), "camPos");
-		this->shaders[j]->setMat4fv(this->ProjectionMatrix, "ProjectionMatrix");
+	// Single upload per frame no matter how many shader programs exist
+	this->frameData.ViewMatrix = this->ViewMatrix;
+	this->frameData.ProjectionMatrix = this->ProjectionMatrix;
+	this->frameData.camPos = glm::vec4(this->camera.getPosition(), 1.f);
+	this->frameData.lightPos0 = glm::vec4(*this->lights[0], 1.f);
+	this->frameUniforms->update(&this->frameData);
+}
+
+// Rebuild model matrices of meshes whose transform changed, static meshes cost nothing
+void Application::updateTransforms() {
+	this->transforms.update();
+
+	// Moved meshes refit their BVH path, new ones are inserted
+	const std::vector<TransformStore::Handle>& updated = this->transforms.getUpdated();
+	for (size_t i = 0; i < updated.size(); i++) {
+		TransformStore::Handle handle = updated[i];
+		if (handle >= this->meshOfTransform.size() || this->meshOfTransform[handle] < 0) {
+			continue;
+		}
+		AABB bounds = this->meshes[this->meshOfTransform[handle]]->getWorldBounds();
+		if (this->sceneBvh.contains(handle)) {
+			this->sceneBvh.refit(handle, bounds);
+		}
+		else {
+			this->sceneBvh.insert(handle, bounds);
+		}
+	}
+
+	// Many incremental inserts degrade the tree, rebuild it with the SAH
+	if (this->sceneBvh.size() > 16 && this->sceneBvh.getInsertsSinceBuild() > this->sceneBvh.size() / 2) {
+		this->rebuildBvh();
 	}
 }
 
+// Collect meshes inside the camera frustum from the BVH
+void Application::cullMeshes() {
+	Frustum frustum = this->camera.getFrustum(this->ProjectionMatrix);
+
+	this->visibleHandles.clear();
+	this->sceneBvh.queryFrustum(frustum, this->visibleHandles);
+
+	this->visibleMeshes = this->visibleHandles.size();
+	this->culledMeshes = this->meshes.size() - this->visibleMeshes;
+}
+
 // Keyboard Input Actions
 void Application::updateKeyboardInput()
 {
@@ -295,7 +357,7 @@ void Application::updateKeyboardInput()
 		this->camera.updateKeyboardInput(this->delta, 7);
 	}
 
-	if (!this->freelook) {
+	if (!this->freelook && this->hasSelection()) {
 		// Move Selected Mesh with Camera in edit mode
 		this->meshes[this->selected]->setPosition(this->camera.getPosition() + this->camera.getFront() + this->camera.getFront());
 
@@ -348,7 +410,7 @@ void Application::updateDelta()
 	this->delta = this->now - this->before;
 	this->before = this->now;
 	fps = 1 / delta;
-	std::cout << "Framerate : " << fps << " fps" << std::endl;
+	std::cout << "Framerate : " << fps << " fps | Visible : " << this->visibleMeshes << " Culled : " << this->culledMeshes << std::endl;
 }
 
 // Mouse Input
@@ -372,21 +434,108 @@ void Application::updateMouseInput() {
 // Add new Object
 void Application::addObject(int type)
 {
+	std::shared_ptr<Geometry> geometry;
 	if (type == GLFW_KEY_C) {
-		Cube c = Cube();
-		this->meshes.push_back(new Mesh(&c, this->textures[0], this->textures[1], this->materials[0]));
-		this->meshes[this->meshes.size() - 1]->setPosition(this->camera.getPosition() + this->camera.getFront() + this->camera.getFront());
+		geometry = this->geometries.acquire<Cube>("Cube");
 	}
 	else if (type == GLFW_KEY_V) {
-		Prism c = Prism();
-		this->meshes.push_back(new Mesh(&c, this->textures[0], this->textures[1], this->materials[0]));
-		this->meshes[this->meshes.size() - 1]->setPosition(this->camera.getPosition() + this->camera.getFront() + this->camera.getFront());
+		geometry = this->geometries.acquire<Prism>("Prism");
 	}
 	else if (type == GLFW_KEY_B) {
-		Pyramid c = Pyramid();
-		this->meshes.push_back(new Mesh(&c, this->textures[0], this->textures[1], this->materials[0]));
-		this->meshes[this->meshes.size() - 1]->setPosition(this->camera.getPosition() + this->camera.getFront() + this->camera.getFront());
+		geometry = this->geometries.acquire<Pyramid>("Pyramid");
+	}
+	else {
+		return;
+	}
+
+	// Every placed object shares the buffers of its primitive type
+	Mesh* mesh = new Mesh(&this->transforms, geometry, this->materialLibrary->get(0));
+	mesh->setPosition(this->camera.getPosition() + this->camera.getFront() + this->camera.getFront());
+	this->addMesh(mesh);
+}
+
+// Import a model file in front of the camera, geometry is shared by later imports of the same file
+bool Application::importModel(const std::string& fileName)
+{
+	glm::vec3 origin = this->camera.getPosition() + this->camera.getFront() + this->camera.getFront();
+
+	// glTF binary scenes keep their node placement and materials, relative to the import point
+	if (fileName.size() > 4 && fileName.compare(fileName.size() - 4, 4, ".glb") == 0) {
+		GltfScene scene(fileName, &this->geometries, this->materialLibrary, this->textureCache, this->textureSampler);
+		if (!scene.isLoaded()) {
+			return false;
+		}
+		const std::vector<GltfInstance>& instances = scene.getInstances();
+		for (size_t i = 0; i < instances.size(); i++) {
+			glm::vec3 position, rotation, scale;
+			TransformStore::decompose(instances[i].world, position, rotation, scale);
+			this->addMesh(new Mesh(&this->transforms, instances[i].geometry, instances[i].material, origin + position, rotation, scale));
+		}
+		return true;
+	}
+
+	// OBJ files are parsed once, later imports map the cooked .mesh file next to them
+	std::shared_ptr<Geometry> geometry = this->geometries.find(fileName);
+	if (!geometry) {
+		GeometryStreams streams;
+		if (!MeshCooker::loadOrImport<ObjModel>(fileName, this->geometries.getFormat(), streams)) {
+			return false;
+		}
+		geometry = this->geometries.add(fileName, streams);
+	}
+
+	Mesh* mesh = new Mesh(&this->transforms, geometry, this->materialLibrary->get(0));
+	mesh->setPosition(origin);
+	this->addMesh(mesh);
+	return true;
+}
+
+// Register mesh with the scene, it enters the BVH on the next transform update
+void Application::addMesh(Mesh* mesh)
+{
+	this->meshes.push_back(mesh);
+
+	TransformStore::Handle handle = mesh->getTransform();
+	if (handle >= this->meshOfTransform.size()) {
+		this->meshOfTransform.resize(handle + 1, -1);
 	}
+	this->meshOfTransform[handle] = static_cast<int32_t>(this->meshes.size() - 1);
+}
+
+// Full binned SAH rebuild over every mesh
+void Application::rebuildBvh()
+{
+	std::vector<uint32_t> items(this->meshes.size());
+	std::vector<AABB> bounds(this->meshes.size());
+	for (size_t i = 0; i < this->meshes.size(); i++) {
+		items[i] = this->meshes[i]->getTransform();
+		bounds[i] = this->meshes[i]->getWorldBounds();
+	}
+	this->sceneBvh.build(items, bounds);
+}
+
+// Whether selected indexes an existing mesh
+bool Application::hasSelection() const
+{
+	return this->selected >= 0 && static_cast<size_t>(this->selected) < this->meshes.size();
+}
+
+// Closest mesh under a point in normalized device coordinates, -1 if none
+// BVH broad phase, exact triangle tests only for boxes the ray reaches before the best hit
+int Application::pickMesh(float ndcX, float ndcY)
+{
+	glm::vec3 origin, direction;
+	this->camera.getPickRay(this->ProjectionMatrix, ndcX, ndcY, origin, direction);
+
+	float tMax = this->drawDistance;
+	int32_t handle = this->sceneBvh.raycast(origin, direction, tMax, [&](uint32_t item, float tLimit) {
+		return this->meshes[this->meshOfTransform[item]]->intersectRay(origin, direction, tLimit);
+	});
+
+	if (handle == Bvh::NONE) {
+		return -1;
+	}
+	return this->meshOfTransform[handle];
 }
 
 /* ========================= RENDER =========================== */
@@ -395,42 +544,123 @@ void Application::render() {
 	glClearColor(0.0f, 0.03f, 0.1f, 1.f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 	
+	// Upload textures decoded since the last frame, then drop unused ones if over budget
+	this->textureStreamer->update();
+	this->textureCache->trim();
+
+	// Copy newly uploaded material images into their texture arrays
+	this->materialLibrary->update();
+
+	// Texture loading binds outside the cache, so bindings are trusted within one frame only
+	this->glState.invalidate();
+
 	// Update changed uniforms with keyboard input
 	this->updateUniforms();
 
-	// Activate default material on default shader program
-	int j;
-	for (j = 0; j < shaders.size(); j++) {
-		this->materials[j]->sendToShader(*this->shaders[j]);
-	}
-	
-	// Use default shader program
-	this->shaders[1]->use();
-	
-	// Render Grid
-	int i;
-	for (i = 0; i < 60; i++) {
-		this->grid[i]->render(this->shaders[0]);
-	}
+	// Bulk pass over dirty transforms before anything reads a model matrix
+	this->updateTransforms();
+
+	// Skip meshes outside the view frustum
+	this->cullMeshes();
+
+	// Default render state
+	this->glState.enable(GL_DEPTH_TEST);
+	this->glState.enable(GL_CULL_FACE);
+	this->glState.enable(GL_BLEND);
+	this->glState.polygonMode(GL_FILL);
 
 	// Render Meshes
-	// In Edit mode wireframe unselected meshes
-	if (!this->freelook) {
-		this->meshes[this->selected]->render(this->shaders[1]);
+	this->renderQueue->begin(this->camera.getPosition(), this->camera.getFront(), this->drawDistance);
+	// In Edit mode highlight the selected mesh with the second shader program
+	Mesh* highlighted = this->freelook || !this->hasSelection() ? nullptr : this->meshes[this->selected];
+	for (size_t i = 0; i < this->visibleHandles.size(); i++) {
+		Mesh* mesh = this->meshes[this->meshOfTransform[this->visibleHandles[i]]];
+		// Object ids are mesh index + 1, zero is left for the background
+		GLuint objectId = static_cast<GLuint>(this->meshOfTransform[this->visibleHandles[i]] + 1);
+		this->renderQueue->submit(mesh, mesh == highlighted ? this->shaders[1] : this->shaders[0], objectId);
 	}
-	for (i = 0; i < this->meshes.size(); i++) {
-		if(i != this->selected || this->freelook)
-			this->meshes[i]->render(this->shaders[0]);
+
+	// Sorted by state and depth, matching neighbours are drawn with one instanced call
+	this->renderQueue->flush(this->glState);
+
+	// Pending GPU pick draws the same packets into the id buffer, the result is read a frame or more later
+	this->picker->render(this->glState, *this->renderQueue, this->framebufferWidth, this->framebufferHeight);
+	GLuint pickedId;
+	if (this->picker->poll(pickedId) && pickedId > 0 && pickedId <= this->meshes.size()) {
+		this->selected = static_cast<int>(pickedId - 1);
+		std::cout << "Selected Object " << this->selected << std::endl;
 	}
 
-	// Reset settings
+	// Render Grid
+	this->grid->render(this->glState);
+
+	// Swap, bound state is left as is for the cache
 	glfwSwapBuffers(window);
 	glFlush();
 
-	glBindVertexArray(0);
-	glUseProgram(0);
-	glActiveTexture(0);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	this->glState.endFrame();
+}
+
+/* ========================= BENCHMARKS =========================== */
+// Texture bandwidth : a field of distant textured quads drawn with each filtering setup
+void Application::benchmarkTextures()
+{
+	glfwSwapInterval(0);
+
+	// 16 x 16 quads from 20 to 200 units away, heavily minified
+	for (int row = 0; row < 16; row++) {
+		for (int column = 0; column < 16; column++) {
+			glm::vec3 position(column * 4.f - 30.f, row * 2.f - 15.f, -20.f - row * 12.f);
+			this->addMesh(new Mesh(&this->transforms, this->geometries.acquire<Quad>("Quad"), this->materialLibrary->get(2),
+				position, glm::vec3(0.f), glm::vec3(3.f)));
+		}
+	}
+
+	// Every texture resident before timing
+	while (this->textureStreamer->getPending() > 0) {
+		this->textureStreamer->update();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	this->materialLibrary->update();
+
+	struct Setup {
+		const char* name;
+		GLenum minFilter;
+		float anisotropy;
+	};
+	const Setup setups[] = {
+		{ "linear, no mipmaps (old)", GL_LINEAR, 1.f },
+		{ "bilinear mipmapped", GL_LINEAR_MIPMAP_NEAREST, 1.f },
+		{ "trilinear", GL_LINEAR_MIPMAP_LINEAR, 1.f },
+		{ "trilinear, anisotropic", GL_LINEAR_MIPMAP_LINEAR, Sampler::getMaxAnisotropy() }
+	};
+	const int warmup = 30;
+	const int frames = 300;
+
+	std::cout << "Texture bandwidth : " << this->meshes.size() << " quads, " << frames << " frames per setup" << std::endl;
+	for (size_t i = 0; i < sizeof(setups) / sizeof(setups[0]); i++) {
+		this->textureSampler->setFilters(setups[i].minFilter, GL_LINEAR);
+		this->textureSampler->setAnisotropy(setups[i].anisotropy);
+
+		for (int frame = 0; frame < warmup; frame++) {
+			this->render();
+		}
+		glFinish();
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (int frame = 0; frame < frames; frame++) {
+			this->render();
+			glfwPollEvents();
+		}
+		glFinish();
+		double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+		std::cout << "  " << setups[i].name << " : " << seconds * 1000.0 / frames << " ms/frame, "
+			<< frames / seconds << " FPS" << std::endl;
+	}
+
+	this->textureSampler->setFilters(GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+	this->textureSampler->setAnisotropy(1.f);
 }
 
 /* ========================= CALLBACK FUNCTIONS =========================== */
@@ -439,23 +669,65 @@ void Application::framebuffer_resize_callback(GLFWwindow* window, int framebuffe
 	glViewport(0, 0, framebufferWidth, framebufferHeight);
 };
 
+// Mouse Callback : Left click selects the object under the cursor in freelook mode
+void Application::mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
+{
+	Application* app = static_cast<Application*>(glfwGetWindowUserPointer(window));
+	if (!app->freelook || button != GLFW_MOUSE_BUTTON_LEFT || action != GLFW_PRESS) {
+		return;
+	}
+
+	// Captured cursor means mouselook, pick through the center of the screen
+	float ndcX = 0.f;
+	float ndcY = 0.f;
+	if (glfwGetInputMode(window, GLFW_CURSOR) != GLFW_CURSOR_DISABLED) {
+		double cursorX, cursorY;
+		int windowWidth, windowHeight;
+		glfwGetCursorPos(window, &cursorX, &cursorY);
+		glfwGetWindowSize(window, &windowWidth, &windowHeight);
+		ndcX = static_cast<float>(2.0 * cursorX / windowWidth - 1.0);
+		ndcY = static_cast<float>(1.0 - 2.0 * cursorY / windowHeight);
+	}
+
+	// GPU picking renders the id of the pixel under the cursor and reads it back asynchronously
+	if (app->gpuPicking) {
+		int pixelX = static_cast<int>((ndcX * 0.5f + 0.5f) * app->framebufferWidth);
+		int pixelY = static_cast<int>((ndcY * 0.5f + 0.5f) * app->framebufferHeight);
+		app->picker->request(glm::clamp(pixelX, 0, app->framebufferWidth - 1), glm::clamp(pixelY, 0, app->framebufferHeight - 1));
+		return;
+	}
+
+	int picked = app->pickMesh(ndcX, ndcY);
+	if (picked >= 0) {
+		app->selected = picked;
+		std::cout << "Selected Object " << picked << std::endl;
+	}
+}
+
 // Keyboard Callback
 void Application::key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
 	Application* app = static_cast<Application*>(glfwGetWindowUserPointer(window));
 	if (app->freelook) {
-		if (key > 47 && key < 58 && action == GLFW_PRESS)
-		{
-			app->selected = key - 48;
-		}
-		else if ((key == GLFW_KEY_C || key == GLFW_KEY_B || key == GLFW_KEY_V) && action == GLFW_PRESS) {
+		if ((key == GLFW_KEY_C || key == GLFW_KEY_B || key == GLFW_KEY_V) && action == GLFW_PRESS) {
 			app->addObject(key);
 		}
+		if (key == GLFW_KEY_K && action == GLFW_PRESS) {
+			app->textureSampler->setAnisotropy(app->textureSampler->getAnisotropy() > 1.f ? 1.f : Sampler::getMaxAnisotropy());
+			std::cout << "Anisotropic filtering " << app->textureSampler->getAnisotropy() << "x" << std::endl;
+		}
+		if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+			app->gpuPicking = !app->gpuPicking;
+			std::cout << "Picking with " << (app->gpuPicking ? "GPU id buffer" : "CPU ray cast") << std::endl;
+		}
+		if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+			app->glState.report();
+		}
 	}
 	else {
-		if (key == GLFW_KEY_COMMA && action == GLFW_PRESS) {
-			app->meshes[app->selected]->changeTexture(app->textures[app->currentTexture * 2], app->textures[app->currentTexture * 2 + 1]);
-			app->currentTexture = (app->currentTexture + 1) % (app->textures.size() / 2);
+		if (key == GLFW_KEY_COMMA && action == GLFW_PRESS && app->hasSelection()) {
+			app->meshes[app->selected]->setMaterial(app->materialLibrary->get(app->currentMaterial));
+			app->currentMaterial = (app->currentMaterial + 1) % static_cast<int>(app->materialLibrary->size());
 		}
 	}
 	if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
@@ -464,7 +736,7 @@ void Application::key_callback(GLFWwindow* window, int key, int scancode, int ac
 			std::cout << "Changed mode to Freelook\n";
 		}
 		else {
-			if (app->selected < app->meshes.size()) {
+			if (app->hasSelection()) {
 				glm::vec3 newposition = app->meshes[app->selected]->getPosition() - app->camera.getFront() - app->camera.getFront();
 				app->camera.setCameraPosition(newposition);
 				std::cout << "Changed mode to Edit: Editing Object " << app->selected << std::endl;
@@ -14,8 +14,9 @@ private:
 	int framebufferHeight = WINDOW_HEIGHT;
 
 	bool freelook = true;
+	bool gpuPicking = false;
 	int selected = 0;
-	int currentTexture = 0;
+	int currentMaterial = 0;
 	
 	glm::mat4 ViewMatrix;
 	glm::mat4 ProjectionMatrix;
@@ -25,6 +26,15 @@ private:
 	float drawDistance;
 	float aspectRatio;
 
+	// Hierarchy over world bounds of meshes, items are transform handles
+	Bvh sceneBvh;
+	std::vector<int32_t> meshOfTransform;
+
+	// Frustum culling results of the last frame
+	std::vector<uint32_t> visibleHandles;
+	size_t visibleMeshes;
+	size_t culledMeshes;
+
 	float delta;
 	float now;
 	float before;
@@ -39,11 +49,25 @@ private:
 
 	Camera camera;
 
+	// Per-frame uniform block shared by all shader programs
+	FrameData frameData;
+	UniformBuffer* frameUniforms;
+
+	GLStateCache glState;
+	TextureStreamer* textureStreamer;
+	TextureCache* textureCache;
+	Sampler* textureSampler;
+	GeometryRegistry geometries;
+	TransformStore transforms;
+	RenderQueue* renderQueue;
+	GpuPicker* picker;
+	Grid* grid;
+
 	std::vector<Shader*> shaders;
-	std::vector<Texture*> textures;
-	std::vector<Material*> materials;
+	// Diffuse and specular image pairs, loaded through the texture cache
+	std::vector<std::string> textureFiles;
+	MaterialLibrary* materialLibrary;
 	std::vector<Mesh*> meshes;
-	std::vector<Mesh*> grid;
 	std::vector<glm::vec3*> lights;
 
 
@@ -60,6 +84,12 @@ private:
 	void initLights();
 	void initUniforms();
 	void updateUniforms();
+	void updateTransforms();
+	void cullMeshes();
+	void addMesh(Mesh* mesh);
+	void rebuildBvh();
+	int pickMesh(float ndcX, float ndcY);
+	bool hasSelection() const;
 public:
 	// Functions
 
@@ -69,6 +99,7 @@ public:
 	virtual ~Application();
 
 	void addObject(int type);
+	bool importModel(const std::string& fileName);
 	int getWindowShouldClose();
 	void setWindowShouldClose();
 	void updateDelta();
@@ -76,8 +107,10 @@ public:
 	void updateKeyboardInput();
 	void update();
 	void render();
+	void benchmarkTextures();
 
 	static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+	static void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
 	static void framebuffer_resize_callback(GLFWwindow* window, int framebufferWidth, int framebufferHeight);
 };
 
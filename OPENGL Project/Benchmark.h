@@ -0,0 +1,267 @@
+#pragma once
+
+#include<iostream>
+#include<iomanip>
+#include<string>
+#include<vector>
+#include<chrono>
+#include<cmath>
+#include<cstdlib>
+#include<functional>
+#include<random>
+#include<algorithm>
+
+#include<SOIL2.h>
+
+extern "C" {
+#include<image_DXT.h>
+}
+
+#include"ThreadPool.h"
+#include"DxtCompressor.h"
+#include"MeshOptimizer.h"
+#include"ObjModel.h"
+#include"MeshCooker.h"
+
+// Command line benchmarks, each returns the process exit code
+class Benchmark {
+private:
+	// Seconds per run of body, repeated for at least half a second
+	static double timeRuns(const std::function<void()>& body) {
+		typedef std::chrono::high_resolution_clock Clock;
+		int runs = 0;
+		Clock::time_point start = Clock::now();
+		double elapsed = 0.0;
+		do {
+			body();
+			runs++;
+			elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+		} while (elapsed < 0.5);
+		return elapsed / runs;
+	}
+
+	// Peak signal to noise ratio of the RGB channels in dB
+	static double psnr(const unsigned char* reference, const unsigned char* test, size_t pixels) {
+		double squared = 0.0;
+		for (size_t i = 0; i < pixels; i++) {
+			for (int c = 0; c < 3; c++) {
+				double difference = static_cast<double>(reference[i * 4 + c]) - test[i * 4 + c];
+				squared += difference * difference;
+			}
+		}
+		double mse = squared / (pixels * 3);
+		return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+	}
+
+	// Indexed UV sphere, rings x segments quads
+	static void sphere(int rings, int segments, std::vector<Vertex>& vertices, std::vector<GLuint>& indices) {
+		vertices.clear();
+		indices.clear();
+		for (int ring = 0; ring <= rings; ring++) {
+			float theta = 3.14159265f * ring / rings;
+			for (int segment = 0; segment <= segments; segment++) {
+				float phi = 6.28318531f * segment / segments;
+				Vertex vertex;
+				vertex.normal = glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+				vertex.position = vertex.normal;
+				vertex.color = glm::vec3(1.f);
+				vertex.texcoord = glm::vec2(static_cast<float>(segment) / segments, static_cast<float>(ring) / rings);
+				vertices.push_back(vertex);
+			}
+		}
+		for (int ring = 0; ring < rings; ring++) {
+			for (int segment = 0; segment < segments; segment++) {
+				GLuint a = ring * (segments + 1) + segment;
+				GLuint b = a + segments + 1;
+				GLuint quad[6] = { a, b, a + 1, a + 1, b, b + 1 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	// Same triangles in random order, like meshes exported without any cache awareness
+	static void shuffleTriangles(std::vector<GLuint>& indices) {
+		std::vector<size_t> order(indices.size() / 3);
+		for (size_t i = 0; i < order.size(); i++) {
+			order[i] = i;
+		}
+		std::shuffle(order.begin(), order.end(), std::mt19937(1));
+		std::vector<GLuint> shuffled;
+		shuffled.reserve(indices.size());
+		for (size_t i = 0; i < order.size(); i++) {
+			shuffled.insert(shuffled.end(), indices.begin() + order[i] * 3, indices.begin() + order[i] * 3 + 3);
+		}
+		indices.swap(shuffled);
+	}
+
+	static void report(const char* name, double seconds, int width, int height, double quality) {
+		std::cout << std::left << std::setw(24) << name << std::right << std::fixed
+			<< std::setw(10) << std::setprecision(2) << width * static_cast<double>(height) / seconds / 1e6 << " MP/s"
+			<< std::setw(10) << std::setprecision(2) << quality << " dB" << std::endl;
+	}
+
+public:
+	// BC1 throughput and quality of SOIL2 against DxtCompressor at every quality, serial and on all cores
+	static int dxt(const char* fileName) {
+		int width, height;
+		unsigned char* rgba = SOIL_load_image(fileName, &width, &height, NULL, SOIL_LOAD_RGBA);
+		if (!rgba) {
+			std::cout << "ERROR : Benchmark::dxt - Could not load " << fileName << std::endl;
+			return 1;
+		}
+		size_t pixels = static_cast<size_t>(width) * height;
+		std::cout << "BC1 compression of " << fileName << " (" << width << " x " << height << ")" << std::endl;
+
+		std::vector<unsigned char> blocks;
+		std::vector<unsigned char> decoded;
+
+		// SOIL2 reference
+		double seconds = timeRuns([&]() {
+			int size = 0;
+			unsigned char* compressed = convert_image_to_DXT1(rgba, width, height, 4, &size);
+			blocks.assign(compressed, compressed + size);
+			free(compressed);
+		});
+		DxtCompressor::decompress(blocks.data(), width, height, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, decoded);
+		report("SOIL2", seconds, width, height, psnr(rgba, decoded.data(), pixels));
+
+		ThreadPool pool(std::thread::hardware_concurrency());
+		const char* names[3][2] = {
+			{ "fast", "fast, threaded" },
+			{ "normal", "normal, threaded" },
+			{ "high", "high, threaded" }
+		};
+		for (int quality = DXT_FAST; quality <= DXT_HIGH; quality++) {
+			for (int threaded = 0; threaded < 2; threaded++) {
+				ThreadPool* workers = threaded ? &pool : NULL;
+				seconds = timeRuns([&]() {
+					DxtCompressor::compress(rgba, width, height, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, static_cast<DxtQuality>(quality), blocks, workers);
+				});
+				DxtCompressor::decompress(blocks.data(), width, height, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, decoded);
+				report(names[quality][threaded], seconds, width, height, psnr(rgba, decoded.data(), pixels));
+			}
+		}
+		std::cout << "DXT_SIMD " << DXT_SIMD << ", " << pool.getThreadCount() << " threads" << std::endl;
+
+		SOIL_free_image_data(rgba);
+		return 0;
+	}
+
+	// OBJ parse throughput on all cores, then the optimize and cook steps of an import on their own,
+	// then the reload of its cooked .mesh file (written next to it)
+	// The reload covers mapping, validation and the CPU copies, not the driver upload
+	static int obj(const char* fileName) {
+		ThreadPool pool(std::thread::hardware_concurrency());
+		size_t vertices = 0;
+		size_t triangles = 0;
+		uint64_t sourceSize;
+		int64_t sourceTime;
+		CookedMesh mesh;
+		if (!MeshCooker::sourceStamp(fileName, sourceSize, sourceTime)) {
+			return 1;
+		}
+		typedef std::chrono::high_resolution_clock Clock;
+		double seconds;
+		double optimizeSeconds;
+		double cookSeconds;
+		{
+			Clock::time_point start = Clock::now();
+			ObjModel model(fileName, &pool);
+			if (!model.isLoaded()) {
+				return 1;
+			}
+			seconds = std::chrono::duration<double>(Clock::now() - start).count();
+			vertices = model.getNvertices();
+			triangles = model.getNindices() / 3;
+
+			start = Clock::now();
+			MeshOptimizer::optimize(&model);
+			optimizeSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+			start = Clock::now();
+			MeshCooker::cook(&model, DEFAULT_VERTEX_FORMAT, mesh);
+			cookSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+		}
+
+		MappedFile file(fileName);
+		std::cout << fileName << " : " << vertices << " vertices, " << triangles << " triangles in " << std::fixed
+			<< std::setprecision(2) << seconds << " s, " << file.getSize() / seconds / 1e6 << " MB/s on "
+			<< pool.getThreadCount() << " threads" << std::endl;
+		std::cout << "optimized in " << optimizeSeconds << " s, cooked in " << cookSeconds << " s" << std::endl;
+
+		mesh.header.sourceSize = sourceSize;
+		mesh.header.sourceTime = sourceTime;
+		std::string path = MeshCooker::cookedPath(fileName);
+		if (!MeshCooker::save(path, mesh)) {
+			return 1;
+		}
+		Clock::time_point start = Clock::now();
+		std::vector<glm::vec3> positions;
+		std::vector<GLuint> indices;
+		MappedFile cooked(path);
+		MeshCacheView view;
+		if (!cooked.isOpen() || !MeshCooker::read(cooked.getData(), cooked.getSize(), DEFAULT_VERTEX_FORMAT, sourceSize, sourceTime, view)
+			|| !MeshCooker::readPositions(view, positions, indices)) {
+			return 1;
+		}
+		seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		std::cout << path << " : reloaded in " << std::setprecision(3) << seconds << " s, "
+			<< std::setprecision(2) << cooked.getSize() / seconds / 1e6 << " MB/s" << std::endl;
+		return 0;
+	}
+
+	// Post-transform cache efficiency of high-poly spheres before and after MeshOptimizer
+	// ACMR is the number of vertex shader runs per triangle with a FIFO cache of MeshOptimizer::CACHE_SIZE
+	static int meshopt() {
+		struct Case {
+			const char* name;
+			int rings;
+			int segments;
+			bool shuffled;
+		};
+		const Case cases[] = {
+			{ "sphere 64k, generated", 180, 360, false },
+			{ "sphere 64k, shuffled", 180, 360, true },
+			{ "sphere 1M, generated", 720, 1440, false },
+			{ "sphere 1M, shuffled", 720, 1440, true }
+		};
+
+		std::cout << std::left << std::setw(24) << "Mesh" << std::right
+			<< std::setw(10) << "Tris" << std::setw(10) << "Input" << std::setw(10) << "Cache"
+			<< std::setw(10) << "Overdraw" << std::setw(12) << "MTris/s" << std::setw(20) << "Index MB" << std::endl;
+		for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+			std::vector<Vertex> vertices;
+			std::vector<GLuint> indices;
+			sphere(cases[i].rings, cases[i].segments, vertices, indices);
+			if (cases[i].shuffled) {
+				shuffleTriangles(indices);
+			}
+			size_t triangles = indices.size() / 3;
+
+			std::vector<Vertex> optimizedVertices;
+			std::vector<GLuint> optimizedIndices;
+			MeshOptimizerStats stats;
+			double seconds = timeRuns([&]() {
+				optimizedVertices = vertices;
+				optimizedIndices = indices;
+				stats = MeshOptimizer::optimize(optimizedVertices, optimizedIndices);
+			});
+
+			optimizedVertices = vertices;
+			optimizedIndices = indices;
+			MeshOptimizerStats overdraw = MeshOptimizer::optimize(optimizedVertices, optimizedIndices, true);
+
+			// What Geometry uploads, 16-bit indices when every vertex fits
+			size_t indexSize = optimizedVertices.size() <= 0x10000 ? sizeof(GLushort) : sizeof(GLuint);
+			std::cout << std::left << std::setw(24) << cases[i].name << std::right << std::fixed
+				<< std::setw(10) << triangles
+				<< std::setw(10) << std::setprecision(3) << stats.acmrBefore
+				<< std::setw(10) << std::setprecision(3) << stats.acmrAfter
+				<< std::setw(10) << std::setprecision(3) << overdraw.acmrAfter
+				<< std::setw(12) << std::setprecision(2) << triangles / seconds / 1e6
+				<< std::setw(10) << std::setprecision(2) << indices.size() * sizeof(GLuint) / 1e6 << " -> "
+				<< std::setw(6) << std::setprecision(2) << indices.size() * indexSize / 1e6 << std::endl;
+		}
+		return 0;
+	}
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include<cfloat>
+#include<cmath>
+
+#include<glm.hpp>
+#include<vec3.hpp>
+#include<mat4x4.hpp>
+
+// Axis aligned bounding box
+struct AABB
+{
+	glm::vec3 min;
+	glm::vec3 max;
+
+	AABB() : min(FLT_MAX), max(-FLT_MAX) {
+
+	}
+
+	AABB(const glm::vec3& min, const glm::vec3& max) : min(min), max(max) {
+
+	}
+
+	void expand(const glm::vec3& point) {
+		this->min = glm::min(this->min, point);
+		this->max = glm::max(this->max, point);
+	}
+
+	void expand(const AABB& other) {
+		this->min = glm::min(this->min, other.min);
+		this->max = glm::max(this->max, other.max);
+	}
+
+	bool valid() const {
+		return this->min.x <= this->max.x;
+	}
+
+	glm::vec3 center() const {
+		return (this->min + this->max) * 0.5f;
+	}
+
+	glm::vec3 extent() const {
+		return (this->max - this->min) * 0.5f;
+	}
+
+	// Surface area, the cost metric of the BVH
+	float area() const {
+		if (!this->valid()) {
+			return 0.f;
+		}
+		glm::vec3 size = this->max - this->min;
+		return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	bool contains(const AABB& other) const {
+		return glm::all(glm::lessThanEqual(this->min, other.min)) && glm::all(glm::greaterThanEqual(this->max, other.max));
+	}
+
+	bool overlaps(const AABB& other) const {
+		return glm::all(glm::lessThanEqual(this->min, other.max)) && glm::all(glm::greaterThanEqual(this->max, other.min));
+	}
+
+	// Box around this box after transform (Arvo), stays tight under rotation of the box axes
+	AABB transformed(const glm::mat4& transform) const {
+		glm::vec3 center = glm::vec3(transform * glm::vec4(this->center(), 1.f));
+		glm::vec3 extent = this->extent();
+		glm::vec3 worldExtent(
+			std::fabs(transform[0][0]) * extent.x + std::fabs(transform[1][0]) * extent.y + std::fabs(transform[2][0]) * extent.z,
+			std::fabs(transform[0][1]) * extent.x + std::fabs(transform[1][1]) * extent.y + std::fabs(transform[2][1]) * extent.z,
+			std::fabs(transform[0][2]) * extent.x + std::fabs(transform[1][2]) * extent.y + std::fabs(transform[2][2]) * extent.z);
+		return AABB(center - worldExtent, center + worldExtent);
+	}
+
+	// Slab test, tNear is the entry distance along the ray when it hits within [0, tMax]
+	bool intersectRay(const glm::vec3& origin, const glm::vec3& inverseDirection, float tMax, float& tNear) const {
+		glm::vec3 t0 = (this->min - origin) * inverseDirection;
+		glm::vec3 t1 = (this->max - origin) * inverseDirection;
+		glm::vec3 tSmall = glm::min(t0, t1);
+		glm::vec3 tBig = glm::max(t0, t1);
+		float enter = glm::max(glm::max(tSmall.x, tSmall.y), glm::max(tSmall.z, 0.f));
+		float exit = glm::min(glm::min(tBig.x, tBig.y), glm::min(tBig.z, tMax));
+		tNear = enter;
+		return enter <= exit;
+	}
+};
+
+inline AABB merge(const AABB& a, const AABB& b) {
+	return AABB(glm::min(a.min, b.min), glm::max(a.max, b.max));
+}
+
+// Bounding sphere
+struct BoundingSphere
+{
+	glm::vec3 center;
+	float radius;
+
+	BoundingSphere() : center(0.f), radius(0.f) {
+
+	}
+
+	BoundingSphere(const glm::vec3& center, float radius) : center(center), radius(radius) {
+
+	}
+};
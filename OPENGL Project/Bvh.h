@@ -0,0 +1,451 @@
+#pragma once
+
+#include<vector>
+#include<cstdint>
+#include<cfloat>
+#include<algorithm>
+
+#include<glm.hpp>
+#include<vec3.hpp>
+
+#include"Bounds.h"
+#include"Frustum.h"
+
+// Dynamic bounding volume hierarchy over world space boxes, one item per leaf
+// Built top-down with a binned SAH, new items are inserted incrementally and
+// moved items only refit the path from their leaf to the root
+class Bvh {
+public:
+	enum : int32_t { NONE = -1 };
+
+private:
+	static const unsigned BINS = 12;
+
+	struct Node {
+		AABB bounds;
+		int32_t parent;
+		int32_t left;
+		int32_t right;
+		int32_t item;
+
+		bool isLeaf() const {
+			return this->left == NONE;
+		}
+	};
+
+	struct BuildItem {
+		uint32_t item;
+		AABB bounds;
+		glm::vec3 centroid;
+	};
+
+	std::vector<Node> nodes;
+	std::vector<int32_t> freeNodes;
+	std::vector<int32_t> leafOfItem;
+	std::vector<int32_t> stack;
+	int32_t root;
+	size_t leafCount;
+	size_t insertsSinceBuild;
+
+	int32_t allocateNode() {
+		int32_t index;
+		if (!this->freeNodes.empty()) {
+			index = this->freeNodes.back();
+			this->freeNodes.pop_back();
+		}
+		else {
+			index = static_cast<int32_t>(this->nodes.size());
+			this->nodes.push_back(Node());
+		}
+		Node& node = this->nodes[index];
+		node.bounds = AABB();
+		node.parent = node.left = node.right = node.item = NONE;
+		return index;
+	}
+
+	void freeNode(int32_t index) {
+		this->freeNodes.push_back(index);
+	}
+
+	// Recompute boxes from index up to the root, stops once a box no longer changes
+	void refitUp(int32_t index) {
+		while (index != NONE) {
+			Node& node = this->nodes[index];
+			AABB bounds = merge(this->nodes[node.left].bounds, this->nodes[node.right].bounds);
+			if (bounds.min == node.bounds.min && bounds.max == node.bounds.max) {
+				break;
+			}
+			node.bounds = bounds;
+			index = node.parent;
+		}
+	}
+
+	int32_t makeLeaf(uint32_t item, const AABB& bounds, int32_t parent) {
+		int32_t leaf = this->allocateNode();
+		this->nodes[leaf].bounds = bounds;
+		this->nodes[leaf].parent = parent;
+		this->nodes[leaf].item = static_cast<int32_t>(item);
+		if (item >= this->leafOfItem.size()) {
+			this->leafOfItem.resize(item + 1, NONE);
+		}
+		this->leafOfItem[item] = leaf;
+		this->leafCount++;
+		return leaf;
+	}
+
+	// Binned SAH split of items[begin, end)
+	int32_t buildRecursive(std::vector<BuildItem>& items, size_t begin, size_t end, int32_t parent) {
+		if (end - begin == 1) {
+			return this->makeLeaf(items[begin].item, items[begin].bounds, parent);
+		}
+
+		AABB bounds, centroids;
+		for (size_t i = begin; i < end; i++) {
+			bounds.expand(items[i].bounds);
+			centroids.expand(items[i].centroid);
+		}
+
+		int32_t index = this->allocateNode();
+		this->nodes[index].bounds = bounds;
+		this->nodes[index].parent = parent;
+
+		// Split along the axis where centroids spread the most
+		glm::vec3 spread = centroids.max - centroids.min;
+		int axis = spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2);
+		size_t middle = begin;
+
+		if (spread[axis] > 0.f) {
+			float scale = BINS / spread[axis];
+			size_t counts[BINS] = {};
+			AABB binBounds[BINS];
+			for (size_t i = begin; i < end; i++) {
+				unsigned bin = std::min(static_cast<unsigned>((items[i].centroid[axis] - centroids.min[axis]) * scale), BINS - 1);
+				counts[bin]++;
+				binBounds[bin].expand(items[i].bounds);
+			}
+
+			// Sweep from the right to get the cost of every split plane
+			float rightArea[BINS];
+			size_t rightCount[BINS];
+			AABB right;
+			size_t count = 0;
+			for (unsigned bin = BINS - 1; bin > 0; bin--) {
+				right.expand(binBounds[bin]);
+				count += counts[bin];
+				rightArea[bin] = right.area();
+				rightCount[bin] = count;
+			}
+
+			float bestCost = FLT_MAX;
+			unsigned bestSplit = 0;
+			AABB left;
+			count = 0;
+			for (unsigned split = 1; split < BINS; split++) {
+				left.expand(binBounds[split - 1]);
+				count += counts[split - 1];
+				if (count == 0 || rightCount[split] == 0) {
+					continue;
+				}
+				float cost = count * left.area() + rightCount[split] * rightArea[split];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestSplit = split;
+				}
+			}
+
+			if (bestSplit > 0) {
+				float minimum = centroids.min[axis];
+				BuildItem* split = std::partition(items.data() + begin, items.data() + end, [&](const BuildItem& item) {
+					return std::min(static_cast<unsigned>((item.centroid[axis] - minimum) * scale), BINS - 1) < bestSplit;
+				});
+				middle = split - items.data();
+			}
+		}
+
+		// Coincident centroids or no useful split, halve the range
+		if (middle == begin || middle == end) {
+			middle = begin + (end - begin) / 2;
+		}
+
+		int32_t left = this->buildRecursive(items, begin, middle, index);
+		int32_t right = this->buildRecursive(items, middle, end, index);
+		this->nodes[index].left = left;
+		this->nodes[index].right = right;
+		return index;
+	}
+
+	// Appends every item below index
+	void collect(int32_t index, std::vector<uint32_t>& out) {
+		size_t base = this->stack.size();
+		this->stack.push_back(index);
+		while (this->stack.size() > base) {
+			const Node& node = this->nodes[this->stack.back()];
+			this->stack.pop_back();
+			if (node.isLeaf()) {
+				out.push_back(static_cast<uint32_t>(node.item));
+			}
+			else {
+				this->stack.push_back(node.left);
+				this->stack.push_back(node.right);
+			}
+		}
+	}
+
+public:
+	// Constructor
+	Bvh() {
+		this->root = NONE;
+		this->leafCount = 0;
+		this->insertsSinceBuild = 0;
+	}
+
+	// Destructor
+	~Bvh() {
+
+	}
+
+	void clear() {
+		this->nodes.clear();
+		this->freeNodes.clear();
+		this->leafOfItem.clear();
+		this->root = NONE;
+		this->leafCount = 0;
+		this->insertsSinceBuild = 0;
+	}
+
+	// Rebuild the whole tree from items and their boxes with the binned SAH
+	void build(const std::vector<uint32_t>& items, const std::vector<AABB>& bounds) {
+		this->clear();
+		if (items.empty()) {
+			return;
+		}
+
+		std::vector<BuildItem> buildItems(items.size());
+		for (size_t i = 0; i < items.size(); i++) {
+			buildItems[i].item = items[i];
+			buildItems[i].bounds = bounds[i];
+			buildItems[i].centroid = bounds[i].center();
+		}
+		this->root = this->buildRecursive(buildItems, 0, buildItems.size(), NONE);
+	}
+
+	// Insert item as a new leaf next to the sibling that grows the tree's surface area the least
+	void insert(uint32_t item, const AABB& bounds) {
+		this->insertsSinceBuild++;
+		if (this->root == NONE) {
+			this->root = this->makeLeaf(item, bounds, NONE);
+			return;
+		}
+
+		int32_t sibling = this->root;
+		while (!this->nodes[sibling].isLeaf()) {
+			const Node& node = this->nodes[sibling];
+			float combined = merge(node.bounds, bounds).area();
+			float inheritance = 2.f * (combined - node.bounds.area());
+
+			// Cost of pairing here versus pushing the new leaf further down
+			float costHere = 2.f * combined;
+			float costLeft = merge(this->nodes[node.left].bounds, bounds).area() + inheritance;
+			float costRight = merge(this->nodes[node.right].bounds, bounds).area() + inheritance;
+			if (!this->nodes[node.left].isLeaf()) {
+				costLeft -= this->nodes[node.left].bounds.area();
+			}
+			if (!this->nodes[node.right].isLeaf()) {
+				costRight -= this->nodes[node.right].bounds.area();
+			}
+
+			if (costHere < costLeft && costHere < costRight) {
+				break;
+			}
+			sibling = costLeft < costRight ? node.left : node.right;
+		}
+
+		int32_t oldParent = this->nodes[sibling].parent;
+		int32_t newParent = this->allocateNode();
+		int32_t leaf = this->makeLeaf(item, bounds, newParent);
+
+		this->nodes[newParent].parent = oldParent;
+		this->nodes[newParent].left = sibling;
+		this->nodes[newParent].right = leaf;
+		this->nodes[newParent].bounds = merge(this->nodes[sibling].bounds, bounds);
+		this->nodes[sibling].parent = newParent;
+
+		if (oldParent == NONE) {
+			this->root = newParent;
+		}
+		else {
+			if (this->nodes[oldParent].left == sibling) {
+				this->nodes[oldParent].left = newParent;
+			}
+			else {
+				this->nodes[oldParent].right = newParent;
+			}
+			this->refitUp(oldParent);
+		}
+	}
+
+	// Remove item, its sibling takes the place of their parent
+	void remove(uint32_t item) {
+		if (item >= this->leafOfItem.size() || this->leafOfItem[item] == NONE) {
+			return;
+		}
+		int32_t leaf = this->leafOfItem[item];
+		this->leafOfItem[item] = NONE;
+		this->leafCount--;
+
+		int32_t parent = this->nodes[leaf].parent;
+		this->freeNode(leaf);
+		if (parent == NONE) {
+			this->root = NONE;
+			return;
+		}
+
+		int32_t sibling = this->nodes[parent].left == leaf ? this->nodes[parent].right : this->nodes[parent].left;
+		int32_t grandParent = this->nodes[parent].parent;
+		this->nodes[sibling].parent = grandParent;
+		this->freeNode(parent);
+
+		if (grandParent == NONE) {
+			this->root = sibling;
+		}
+		else {
+			if (this->nodes[grandParent].left == parent) {
+				this->nodes[grandParent].left = sibling;
+			}
+			else {
+				this->nodes[grandParent].right = sibling;
+			}
+			this->refitUp(grandParent);
+		}
+	}
+
+	// Item moved, only boxes on the path from its leaf to the root are touched
+	void refit(uint32_t item, const AABB& bounds) {
+		if (item >= this->leafOfItem.size() || this->leafOfItem[item] == NONE) {
+			return;
+		}
+		int32_t leaf = this->leafOfItem[item];
+		this->nodes[leaf].bounds = bounds;
+		this->refitUp(this->nodes[leaf].parent);
+	}
+
+	// Items whose boxes intersect the frustum, subtrees fully inside are taken without further tests
+	void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) {
+		if (this->root == NONE) {
+			return;
+		}
+		this->stack.clear();
+		this->stack.push_back(this->root);
+		while (!this->stack.empty()) {
+			int32_t index = this->stack.back();
+			this->stack.pop_back();
+			const Node& node = this->nodes[index];
+
+			int result = frustum.classify(node.bounds);
+			if (result < 0) {
+				continue;
+			}
+			if (result > 0 || node.isLeaf()) {
+				this->collect(index, out);
+				continue;
+			}
+			this->stack.push_back(node.left);
+			this->stack.push_back(node.right);
+		}
+	}
+
+	// Items whose boxes overlap bounds
+	void queryOverlap(const AABB& bounds, std::vector<uint32_t>& out) {
+		if (this->root == NONE) {
+			return;
+		}
+		this->stack.clear();
+		this->stack.push_back(this->root);
+		while (!this->stack.empty()) {
+			const Node& node = this->nodes[this->stack.back()];
+			this->stack.pop_back();
+			if (!node.bounds.overlaps(bounds)) {
+				continue;
+			}
+			if (node.isLeaf()) {
+				out.push_back(static_cast<uint32_t>(node.item));
+			}
+			else {
+				this->stack.push_back(node.left);
+				this->stack.push_back(node.right);
+			}
+		}
+	}
+
+	// Closest hit along the ray, nearer children are visited first and boxes beyond the best hit are pruned
+	// hitTest(item, tMax) returns the exact hit distance below tMax or a negative value for a miss
+	// Returns the hit item or NONE, tMax is lowered to the hit distance
+	template<typename HitTest>
+	int32_t raycast(const glm::vec3& origin, const glm::vec3& direction, float& tMax, HitTest hitTest) {
+		if (this->root == NONE) {
+			return NONE;
+		}
+		glm::vec3 inverseDirection = 1.f / direction;
+		int32_t best = NONE;
+		float tNear;
+
+		this->stack.clear();
+		if (this->nodes[this->root].bounds.intersectRay(origin, inverseDirection, tMax, tNear)) {
+			this->stack.push_back(this->root);
+		}
+		while (!this->stack.empty()) {
+			const Node& node = this->nodes[this->stack.back()];
+			this->stack.pop_back();
+
+			// Box may lie behind a hit found after it was pushed
+			if (!node.bounds.intersectRay(origin, inverseDirection, tMax, tNear)) {
+				continue;
+			}
+			if (node.isLeaf()) {
+				float t = hitTest(static_cast<uint32_t>(node.item), tMax);
+				if (t >= 0.f && t < tMax) {
+					tMax = t;
+					best = node.item;
+				}
+				continue;
+			}
+
+			float tLeft, tRight;
+			bool hitLeft = this->nodes[node.left].bounds.intersectRay(origin, inverseDirection, tMax, tLeft);
+			bool hitRight = this->nodes[node.right].bounds.intersectRay(origin, inverseDirection, tMax, tRight);
+			int32_t left = node.left;
+			int32_t right = node.right;
+			if (hitLeft && hitRight) {
+				// Push the far child first so the near one is popped next
+				if (tLeft < tRight) {
+					this->stack.push_back(right);
+					this->stack.push_back(left);
+				}
+				else {
+					this->stack.push_back(left);
+					this->stack.push_back(right);
+				}
+			}
+			else if (hitLeft) {
+				this->stack.push_back(left);
+			}
+			else if (hitRight) {
+				this->stack.push_back(right);
+			}
+		}
+		return best;
+	}
+
+	// Getters
+	inline size_t size() const {
+		return this->leafCount;
+	}
+
+	inline size_t getInsertsSinceBuild() const {
+		return this->insertsSinceBuild;
+	}
+
+	bool contains(uint32_t item) const {
+		return item < this->leafOfItem.size() && this->leafOfItem[item] != NONE;
+	}
+};
@@ -10,6 +10,8 @@
 #include<gtc/matrix_transform.hpp>
 #include<gtc/type_ptr.hpp>
 
+#include"Frustum.h"
+
 class Camera {
 private:
 	// View Matrix : Camera Position, Front and World Up
@@ -131,6 +133,20 @@ public:
 		return this->ViewMatrix;
 	}
 
+	// Frustum planes of the last view matrix combined with projection
+	Frustum getFrustum(const glm::mat4& projection) {
+		return Frustum::fromMatrix(projection * this->ViewMatrix);
+	}
+
+	// World space ray through a point in normalized device coordinates
+	void getPickRay(const glm::mat4& projection, float ndcX, float ndcY, glm::vec3& origin, glm::vec3& direction) {
+		glm::mat4 inverseViewProjection = glm::inverse(projection * this->ViewMatrix);
+		glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, -1.f, 1.f);
+		glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, 1.f, 1.f);
+		origin = glm::vec3(nearPoint) / nearPoint.w;
+		direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+	}
+
 	const glm::vec3 getPosition() {
 		return this->position;
 	}
@@ -0,0 +1,532 @@
+#pragma once
+
+#include<vector>
+#include<cmath>
+#include<cstdint>
+#include<cstring>
+#include<algorithm>
+
+#include<glew.h>
+
+#include"ThreadPool.h"
+
+// SSE2 is part of every x64 target and of x86 builds with /arch:SSE2 or higher
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DXT_SIMD 1
+#include<emmintrin.h>
+#else
+#define DXT_SIMD 0
+#endif
+
+// Quality / speed trade off of the color endpoint search
+enum DxtQuality {
+	DXT_FAST = 0,	// Bounding box of the block, inset
+	DXT_NORMAL = 1,	// Principal axis of the block colors
+	DXT_HIGH = 2	// Principal axis refined by least squares on the chosen indices
+};
+
+// BC1 / BC3 / BC4 block compressor
+// Blocks are independent, rows of blocks are spread over a thread pool when one is given
+class DxtCompressor {
+private:
+	// One 4x4 block split into channels, 16 byte aligned for SSE loads
+	struct Block {
+		alignas(16) float r[16];
+		alignas(16) float g[16];
+		alignas(16) float b[16];
+		unsigned char a[16];
+	};
+
+	static int blockBytes(GLenum format) {
+		return format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? 16 : 8;
+	}
+
+	// Copy the block at bx, by, edge blocks repeat the last row and column
+	static void loadBlock(const unsigned char* rgba, int width, int height, int bx, int by, Block& block) {
+		for (int i = 0; i < 16; i++) {
+			int x = std::min(bx * 4 + i % 4, width - 1);
+			int y = std::min(by * 4 + i / 4, height - 1);
+			const unsigned char* pixel = rgba + (static_cast<size_t>(y) * width + x) * 4;
+			block.r[i] = pixel[0];
+			block.g[i] = pixel[1];
+			block.b[i] = pixel[2];
+			block.a[i] = pixel[3];
+		}
+	}
+
+	static uint16_t pack565(const float color[3]) {
+		int r = static_cast<int>(std::min(std::max(color[0], 0.f), 255.f) * 31.f / 255.f + 0.5f);
+		int g = static_cast<int>(std::min(std::max(color[1], 0.f), 255.f) * 63.f / 255.f + 0.5f);
+		int b = static_cast<int>(std::min(std::max(color[2], 0.f), 255.f) * 31.f / 255.f + 0.5f);
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	static void unpack565(uint16_t packed, float color[3]) {
+		int r = (packed >> 11) & 31;
+		int g = (packed >> 5) & 63;
+		int b = packed & 31;
+		color[0] = static_cast<float>((r << 3) | (r >> 2));
+		color[1] = static_cast<float>((g << 2) | (g >> 4));
+		color[2] = static_cast<float>((b << 3) | (b >> 2));
+	}
+
+	// Four color palette of two packed endpoints, in block index order
+	static void buildPalette(uint16_t c0, uint16_t c1, float palette[4][3]) {
+		unpack565(c0, palette[0]);
+		unpack565(c1, palette[1]);
+		for (int c = 0; c < 3; c++) {
+			palette[2][c] = (2.f * palette[0][c] + palette[1][c]) / 3.f;
+			palette[3][c] = (palette[0][c] + 2.f * palette[1][c]) / 3.f;
+		}
+	}
+
+	// Nearest palette entry of every pixel, returns the summed squared error
+	static float chooseIndices(const Block& block, const float palette[4][3], int indices[16]) {
+#if DXT_SIMD
+		__m128 total = _mm_setzero_ps();
+		for (int group = 0; group < 16; group += 4) {
+			__m128 r = _mm_load_ps(block.r + group);
+			__m128 g = _mm_load_ps(block.g + group);
+			__m128 b = _mm_load_ps(block.b + group);
+
+			__m128 best = _mm_set1_ps(1e30f);
+			__m128i bestIndex = _mm_setzero_si128();
+			for (int entry = 0; entry < 4; entry++) {
+				__m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette[entry][0]));
+				__m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette[entry][1]));
+				__m128 db = _mm_sub_ps(b, _mm_set1_ps(palette[entry][2]));
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+
+				__m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+				bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(entry)), _mm_andnot_si128(closer, bestIndex));
+				best = _mm_min_ps(distance, best);
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(indices + group), bestIndex);
+			total = _mm_add_ps(total, best);
+		}
+		alignas(16) float sums[4];
+		_mm_store_ps(sums, total);
+		return sums[0] + sums[1] + sums[2] + sums[3];
+#else
+		float total = 0.f;
+		for (int i = 0; i < 16; i++) {
+			float best = 1e30f;
+			for (int entry = 0; entry < 4; entry++) {
+				float dr = block.r[i] - palette[entry][0];
+				float dg = block.g[i] - palette[entry][1];
+				float db = block.b[i] - palette[entry][2];
+				float distance = dr * dr + dg * dg + db * db;
+				if (distance < best) {
+					best = distance;
+					indices[i] = entry;
+				}
+			}
+			total += best;
+		}
+		return total;
+#endif
+	}
+
+	// Mean and covariance (rr, rg, rb, gg, gb, bb) of the block colors
+	static void statistics(const Block& block, float mean[3], float covariance[6]) {
+#if DXT_SIMD
+		__m128 sr = _mm_setzero_ps();
+		__m128 sg = _mm_setzero_ps();
+		__m128 sb = _mm_setzero_ps();
+		for (int group = 0; group < 16; group += 4) {
+			sr = _mm_add_ps(sr, _mm_load_ps(block.r + group));
+			sg = _mm_add_ps(sg, _mm_load_ps(block.g + group));
+			sb = _mm_add_ps(sb, _mm_load_ps(block.b + group));
+		}
+		alignas(16) float sums[3][4];
+		_mm_store_ps(sums[0], sr);
+		_mm_store_ps(sums[1], sg);
+		_mm_store_ps(sums[2], sb);
+		for (int c = 0; c < 3; c++) {
+			mean[c] = (sums[c][0] + sums[c][1] + sums[c][2] + sums[c][3]) / 16.f;
+		}
+
+		__m128 mr = _mm_set1_ps(mean[0]);
+		__m128 mg = _mm_set1_ps(mean[1]);
+		__m128 mb = _mm_set1_ps(mean[2]);
+		__m128 products[6] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+		for (int group = 0; group < 16; group += 4) {
+			__m128 r = _mm_sub_ps(_mm_load_ps(block.r + group), mr);
+			__m128 g = _mm_sub_ps(_mm_load_ps(block.g + group), mg);
+			__m128 b = _mm_sub_ps(_mm_load_ps(block.b + group), mb);
+			products[0] = _mm_add_ps(products[0], _mm_mul_ps(r, r));
+			products[1] = _mm_add_ps(products[1], _mm_mul_ps(r, g));
+			products[2] = _mm_add_ps(products[2], _mm_mul_ps(r, b));
+			products[3] = _mm_add_ps(products[3], _mm_mul_ps(g, g));
+			products[4] = _mm_add_ps(products[4], _mm_mul_ps(g, b));
+			products[5] = _mm_add_ps(products[5], _mm_mul_ps(b, b));
+		}
+		alignas(16) float lanes[4];
+		for (int i = 0; i < 6; i++) {
+			_mm_store_ps(lanes, products[i]);
+			covariance[i] = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		}
+#else
+		mean[0] = mean[1] = mean[2] = 0.f;
+		for (int i = 0; i < 16; i++) {
+			mean[0] += block.r[i];
+			mean[1] += block.g[i];
+			mean[2] += block.b[i];
+		}
+		for (int c = 0; c < 3; c++) {
+			mean[c] /= 16.f;
+		}
+		for (int i = 0; i < 6; i++) {
+			covariance[i] = 0.f;
+		}
+		for (int i = 0; i < 16; i++) {
+			float r = block.r[i] - mean[0];
+			float g = block.g[i] - mean[1];
+			float b = block.b[i] - mean[2];
+			covariance[0] += r * r;
+			covariance[1] += r * g;
+			covariance[2] += r * b;
+			covariance[3] += g * g;
+			covariance[4] += g * b;
+			covariance[5] += b * b;
+		}
+#endif
+	}
+
+	// Bounding box endpoints, the diagonal follows the sign of the covariance
+	static void boxEndpoints(const Block& block, float start[3], float end[3]) {
+		float low[3] = { 255.f, 255.f, 255.f };
+		float high[3] = { 0.f, 0.f, 0.f };
+		for (int i = 0; i < 16; i++) {
+			low[0] = std::min(low[0], block.r[i]);
+			low[1] = std::min(low[1], block.g[i]);
+			low[2] = std::min(low[2], block.b[i]);
+			high[0] = std::max(high[0], block.r[i]);
+			high[1] = std::max(high[1], block.g[i]);
+			high[2] = std::max(high[2], block.b[i]);
+		}
+
+		// Inset by 1/16 of the range so the endpoints are not wasted on outliers
+		for (int c = 0; c < 3; c++) {
+			float inset = (high[c] - low[c]) / 16.f;
+			start[c] = high[c] - inset;
+			end[c] = low[c] + inset;
+		}
+
+		float mean[3];
+		float covariance[6];
+		statistics(block, mean, covariance);
+		if (covariance[1] < 0.f) {
+			std::swap(start[1], end[1]);
+		}
+		if (covariance[2] < 0.f) {
+			std::swap(start[2], end[2]);
+		}
+	}
+
+	// Endpoints on the principal axis of the block colors
+	static void axisEndpoints(const Block& block, float start[3], float end[3]) {
+		float mean[3];
+		float covariance[6];
+		statistics(block, mean, covariance);
+
+		// Power iteration from the largest diagonal
+		float axis[3] = { 1.f, 1.f, 1.f };
+		if (covariance[0] >= covariance[3] && covariance[0] >= covariance[5]) {
+			axis[1] = axis[2] = 0.f;
+		}
+		else if (covariance[3] >= covariance[5]) {
+			axis[0] = axis[2] = 0.f;
+		}
+		else {
+			axis[0] = axis[1] = 0.f;
+		}
+		for (int iteration = 0; iteration < 6; iteration++) {
+			float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+			float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+			float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+			float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+			if (length < 1e-6f) {
+				break;
+			}
+			axis[0] = x / length;
+			axis[1] = y / length;
+			axis[2] = z / length;
+		}
+
+		float low = 1e30f;
+		float high = -1e30f;
+		for (int i = 0; i < 16; i++) {
+			float t = (block.r[i] - mean[0]) * axis[0] + (block.g[i] - mean[1]) * axis[1] + (block.b[i] - mean[2]) * axis[2];
+			low = std::min(low, t);
+			high = std::max(high, t);
+		}
+		float lengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+		if (lengthSquared > 0.f) {
+			low /= lengthSquared;
+			high /= lengthSquared;
+		}
+		// Same inset as the bounding box
+		float inset = (high - low) / 16.f;
+		low += inset;
+		high -= inset;
+		for (int c = 0; c < 3; c++) {
+			start[c] = mean[c] + axis[c] * high;
+			end[c] = mean[c] + axis[c] * low;
+		}
+	}
+
+	// Least squares endpoints for fixed indices, false if the system is singular
+	static bool refineEndpoints(const Block& block, const int indices[16], float start[3], float end[3]) {
+		static const float weights[4] = { 1.f, 0.f, 2.f / 3.f, 1.f / 3.f };
+		float aa = 0.f, bb = 0.f, ab = 0.f;
+		float ax[3] = { 0.f, 0.f, 0.f };
+		float bx[3] = { 0.f, 0.f, 0.f };
+		for (int i = 0; i < 16; i++) {
+			float alpha = weights[indices[i]];
+			float beta = 1.f - alpha;
+			float pixel[3] = { block.r[i], block.g[i], block.b[i] };
+			aa += alpha * alpha;
+			bb += beta * beta;
+			ab += alpha * beta;
+			for (int c = 0; c < 3; c++) {
+				ax[c] += alpha * pixel[c];
+				bx[c] += beta * pixel[c];
+			}
+		}
+		float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) < 1e-6f) {
+			return false;
+		}
+		for (int c = 0; c < 3; c++) {
+			start[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+			end[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+		}
+		return true;
+	}
+
+	// Quantize endpoints and pick indices, returns the block error
+	static float encodeEndpoints(const Block& block, const float start[3], const float end[3], uint16_t& c0, uint16_t& c1, int indices[16]) {
+		c0 = pack565(start);
+		c1 = pack565(end);
+		// Four color mode needs c0 > c1
+		if (c0 < c1) {
+			std::swap(c0, c1);
+		}
+		float palette[4][3];
+		buildPalette(c0, c1, palette);
+		float error = chooseIndices(block, palette, indices);
+		if (c0 == c1) {
+			for (int i = 0; i < 16; i++) {
+				indices[i] = 0;
+			}
+		}
+		return error;
+	}
+
+	static void compressColorBlock(const Block& block, DxtQuality quality, unsigned char* out) {
+		float start[3];
+		float end[3];
+		if (quality == DXT_FAST) {
+			boxEndpoints(block, start, end);
+		}
+		else {
+			axisEndpoints(block, start, end);
+		}
+
+		uint16_t c0, c1;
+		int indices[16];
+		float error = encodeEndpoints(block, start, end, c0, c1, indices);
+
+		if (quality == DXT_HIGH) {
+			for (int iteration = 0; iteration < 2 && error > 0.f; iteration++) {
+				uint16_t r0, r1;
+				int refined[16];
+				if (!refineEndpoints(block, indices, start, end)) {
+					break;
+				}
+				float refinedError = encodeEndpoints(block, start, end, r0, r1, refined);
+				if (refinedError >= error) {
+					break;
+				}
+				error = refinedError;
+				c0 = r0;
+				c1 = r1;
+				memcpy(indices, refined, sizeof(indices));
+			}
+		}
+
+		uint32_t bits = 0;
+		for (int i = 0; i < 16; i++) {
+			bits |= static_cast<uint32_t>(indices[i]) << (2 * i);
+		}
+		out[0] = static_cast<unsigned char>(c0);
+		out[1] = static_cast<unsigned char>(c0 >> 8);
+		out[2] = static_cast<unsigned char>(c1);
+		out[3] = static_cast<unsigned char>(c1 >> 8);
+		for (int i = 0; i < 4; i++) {
+			out[4 + i] = static_cast<unsigned char>(bits >> (8 * i));
+		}
+	}
+
+	static void decodeSingleChannelBlock(const unsigned char* block, unsigned char values[16]) {
+		int ramp[8];
+		ramp[0] = block[0];
+		ramp[1] = block[1];
+		if (ramp[0] > ramp[1]) {
+			for (int i = 2; i < 8; i++) {
+				ramp[i] = ((8 - i) * ramp[0] + (i - 1) * ramp[1]) / 7;
+			}
+		}
+		else {
+			for (int i = 2; i < 6; i++) {
+				ramp[i] = ((6 - i) * ramp[0] + (i - 1) * ramp[1]) / 5;
+			}
+			ramp[6] = 0;
+			ramp[7] = 255;
+		}
+		uint64_t bits = 0;
+		for (int i = 0; i < 6; i++) {
+			bits |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+		}
+		for (int i = 0; i < 16; i++) {
+			values[i] = static_cast<unsigned char>(ramp[(bits >> (3 * i)) & 7]);
+		}
+	}
+
+	static void decodeColorBlock(const unsigned char* block, bool opaque, unsigned char rgba[16][4]) {
+		uint16_t c0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+		uint16_t c1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+		float palette[4][3];
+		buildPalette(c0, c1, palette);
+		bool transparent = false;
+		if (c0 <= c1 && !opaque) {
+			for (int c = 0; c < 3; c++) {
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2.f;
+				palette[3][c] = 0.f;
+			}
+			transparent = true;
+		}
+		uint32_t bits = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+		for (int i = 0; i < 16; i++) {
+			int index = (bits >> (2 * i)) & 3;
+			for (int c = 0; c < 3; c++) {
+				rgba[i][c] = static_cast<unsigned char>(palette[index][c] + 0.5f);
+			}
+			rgba[i][3] = transparent && index == 3 ? 0 : 255;
+		}
+	}
+
+public:
+	// BC4 block from 16 single channel values, 8 interpolated steps between min and max
+	// Also the alpha half of a BC3 block
+	static void compressSingleChannelBlock(const unsigned char values[16], unsigned char block[8]) {
+		int high = 0;
+		int low = 255;
+		for (int i = 0; i < 16; i++) {
+			high = std::max<int>(values[i], high);
+			low = std::min<int>(values[i], low);
+		}
+		block[0] = static_cast<unsigned char>(high);
+		block[1] = static_cast<unsigned char>(low);
+
+		uint64_t indices = 0;
+		if (high > low) {
+			int range = high - low;
+			for (int i = 0; i < 16; i++) {
+				// 0 = high, 7 = low on the ramp, ramp steps 1..6 are codes 2..7
+				int step = ((high - values[i]) * 7 + range / 2) / range;
+				uint64_t code = step == 0 ? 0 : (step == 7 ? 1 : step + 1);
+				indices |= code << (3 * i);
+			}
+		}
+		for (int i = 0; i < 6; i++) {
+			block[2 + i] = static_cast<unsigned char>(indices >> (8 * i));
+		}
+	}
+
+	// Compress an RGBA8 image, format is GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+	// GL_COMPRESSED_RGBA_S3TC_DXT5_EXT or GL_COMPRESSED_RED_RGTC1 (red channel only)
+	// Rows of blocks run on pool when given, the caller must not be one of its workers
+	static void compress(const unsigned char* rgba, int width, int height, GLenum format, DxtQuality quality,
+		std::vector<unsigned char>& out, ThreadPool* pool = NULL) {
+		int blocksX = (width + 3) / 4;
+		int blocksY = (height + 3) / 4;
+		int bytes = blockBytes(format);
+		out.resize(static_cast<size_t>(blocksX) * blocksY * bytes);
+		unsigned char* target = out.data();
+
+		std::function<void(size_t, size_t)> rows = [=](size_t begin, size_t end) {
+			Block block;
+			unsigned char values[16];
+			for (size_t by = begin; by < end; by++) {
+				for (int bx = 0; bx < blocksX; bx++) {
+					loadBlock(rgba, width, height, bx, static_cast<int>(by), block);
+					unsigned char* encoded = target + (by * blocksX + bx) * bytes;
+
+					if (format == GL_COMPRESSED_RED_RGTC1) {
+						for (int i = 0; i < 16; i++) {
+							values[i] = static_cast<unsigned char>(block.r[i]);
+						}
+						compressSingleChannelBlock(values, encoded);
+					}
+					else if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) {
+						compressSingleChannelBlock(block.a, encoded);
+						compressColorBlock(block, quality, encoded + 8);
+					}
+					else {
+						compressColorBlock(block, quality, encoded);
+					}
+				}
+			}
+		};
+
+		if (pool) {
+			pool->parallelFor(blocksY, rows);
+		}
+		else {
+			rows(0, blocksY);
+		}
+	}
+
+	// Back to RGBA8, used to measure compression error
+	static void decompress(const unsigned char* blocks, int width, int height, GLenum format, std::vector<unsigned char>& rgba) {
+		int blocksX = (width + 3) / 4;
+		int blocksY = (height + 3) / 4;
+		int bytes = blockBytes(format);
+		rgba.resize(static_cast<size_t>(width) * height * 4);
+
+		unsigned char pixels[16][4];
+		unsigned char values[16];
+		for (int by = 0; by < blocksY; by++) {
+			for (int bx = 0; bx < blocksX; bx++) {
+				const unsigned char* block = blocks + (static_cast<size_t>(by) * blocksX + bx) * bytes;
+				if (format == GL_COMPRESSED_RED_RGTC1) {
+					decodeSingleChannelBlock(block, values);
+					for (int i = 0; i < 16; i++) {
+						pixels[i][0] = pixels[i][1] = pixels[i][2] = values[i];
+						pixels[i][3] = 255;
+					}
+				}
+				else if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) {
+					decodeSingleChannelBlock(block, values);
+					decodeColorBlock(block + 8, true, pixels);
+					for (int i = 0; i < 16; i++) {
+						pixels[i][3] = values[i];
+					}
+				}
+				else {
+					decodeColorBlock(block, false, pixels);
+				}
+
+				for (int i = 0; i < 16; i++) {
+					int x = bx * 4 + i % 4;
+					int y = by * 4 + i / 4;
+					if (x < width && y < height) {
+						memcpy(&rgba[(static_cast<size_t>(y) * width + x) * 4], pixels[i], 4);
+					}
+				}
+			}
+		}
+	}
+};
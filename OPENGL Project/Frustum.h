@@ -0,0 +1,90 @@
+#pragma once
+
+#include<glm.hpp>
+#include<vec3.hpp>
+#include<mat4x4.hpp>
+
+#include"Bounds.h"
+
+// Six view frustum planes, normals and distances kept in separate arrays
+// A point p is inside a plane when nx * p.x + ny * p.y + nz * p.z + d >= 0
+struct Frustum
+{
+	static const unsigned PLANES = 6;
+
+	float nx[PLANES];
+	float ny[PLANES];
+	float nz[PLANES];
+	float d[PLANES];
+
+	// Planes of a view projection matrix (Gribb and Hartmann), normalized
+	static Frustum fromMatrix(const glm::mat4& viewProjection) {
+		glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+		glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+		glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+		glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+		glm::vec4 planes[PLANES] = {
+			row3 + row0,	// Left
+			row3 - row0,	// Right
+			row3 + row1,	// Bottom
+			row3 - row1,	// Top
+			row3 + row2,	// Near
+			row3 - row2		// Far
+		};
+
+		Frustum frustum;
+		for (unsigned i = 0; i < PLANES; i++) {
+			float length = glm::length(glm::vec3(planes[i]));
+			frustum.nx[i] = planes[i].x / length;
+			frustum.ny[i] = planes[i].y / length;
+			frustum.nz[i] = planes[i].z / length;
+			frustum.d[i] = planes[i].w / length;
+		}
+		return frustum;
+	}
+
+	// True if the sphere is at least partly inside
+	bool intersects(const BoundingSphere& sphere) const {
+		for (unsigned i = 0; i < PLANES; i++) {
+			float distance = this->nx[i] * sphere.center.x + this->ny[i] * sphere.center.y + this->nz[i] * sphere.center.z + this->d[i];
+			if (distance < -sphere.radius) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// True if the box is at least partly inside, tests the corner furthest along each plane normal
+	bool intersects(const AABB& box) const {
+		for (unsigned i = 0; i < PLANES; i++) {
+			float x = this->nx[i] >= 0.f ? box.max.x : box.min.x;
+			float y = this->ny[i] >= 0.f ? box.max.y : box.min.y;
+			float z = this->nz[i] >= 0.f ? box.max.z : box.min.z;
+			if (this->nx[i] * x + this->ny[i] * y + this->nz[i] * z + this->d[i] < 0.f) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// -1 if the box is fully outside, 1 if fully inside, 0 if it crosses a plane
+	int classify(const AABB& box) const {
+		int result = 1;
+		for (unsigned i = 0; i < PLANES; i++) {
+			float xFar = this->nx[i] >= 0.f ? box.max.x : box.min.x;
+			float yFar = this->ny[i] >= 0.f ? box.max.y : box.min.y;
+			float zFar = this->nz[i] >= 0.f ? box.max.z : box.min.z;
+			if (this->nx[i] * xFar + this->ny[i] * yFar + this->nz[i] * zFar + this->d[i] < 0.f) {
+				return -1;
+			}
+			float xNear = this->nx[i] >= 0.f ? box.min.x : box.max.x;
+			float yNear = this->ny[i] >= 0.f ? box.min.y : box.max.y;
+			float zNear = this->nz[i] >= 0.f ? box.min.z : box.max.z;
+			if (this->nx[i] * xNear + this->ny[i] * yNear + this->nz[i] * zNear + this->d[i] < 0.f) {
+				result = 0;
+			}
+		}
+		return result;
+	}
+};
@@ -0,0 +1,230 @@
+#pragma once
+
+#include<iostream>
+
+#include<glew.h>
+#include<glfw3.h>
+
+// Shadows the GL state the renderer touches and skips calls that would not change it
+// In Debug builds counts how many calls were elided each frame, printed on request by report
+class GLStateCache {
+private:
+	static const unsigned MAX_TEXTURE_UNITS = 32;
+
+	// Marks a cached value as unknown, the next call always reaches GL
+	static const GLuint UNKNOWN = 0xFFFFFFFFu;
+
+	GLuint program;
+	GLuint VAO;
+	GLuint activeUnit;
+	GLuint textures[MAX_TEXTURE_UNITS];
+	GLenum textureTargets[MAX_TEXTURE_UNITS];
+	GLuint samplers[MAX_TEXTURE_UNITS];
+
+	GLuint blend;
+	GLuint cullFace;
+	GLuint depthTest;
+
+	GLenum blendSrc, blendDst;
+	GLenum cullMode;
+	GLenum depthFunction;
+	GLuint depthWrite;
+	GLenum polygonFill;
+
+#ifdef _DEBUG
+	unsigned issued;
+	unsigned elided;
+	// Counts of the last finished frame
+	unsigned frameIssued;
+	unsigned frameElided;
+#endif
+
+	// Bookkeeping for the debug counter
+	inline bool changed(bool change) {
+#ifdef _DEBUG
+		if (change) {
+			this->issued++;
+		}
+		else {
+			this->elided++;
+		}
+#endif
+		return change;
+	}
+
+	GLuint* capability(GLenum cap) {
+		switch (cap) {
+		case GL_BLEND:
+			return &this->blend;
+		case GL_CULL_FACE:
+			return &this->cullFace;
+		case GL_DEPTH_TEST:
+			return &this->depthTest;
+		default:
+			return nullptr;
+		}
+	}
+
+	void setCapability(GLenum cap, bool enabled) {
+		GLuint* state = this->capability(cap);
+		if (state == nullptr) {
+			// Not tracked, always forward
+			enabled ? glEnable(cap) : glDisable(cap);
+			return;
+		}
+		if (this->changed(*state != static_cast<GLuint>(enabled))) {
+			enabled ? glEnable(cap) : glDisable(cap);
+			*state = enabled;
+		}
+	}
+
+public:
+	// Constructor
+	GLStateCache() {
+#ifdef _DEBUG
+		this->issued = 0;
+		this->elided = 0;
+		this->frameIssued = 0;
+		this->frameElided = 0;
+#endif
+		this->invalidate();
+	}
+
+	// Destructor
+	~GLStateCache() {
+
+	}
+
+	// Forget everything, next call of each kind always reaches GL
+	// Use after code that changes GL state without going through the cache
+	void invalidate() {
+		this->program = UNKNOWN;
+		this->VAO = UNKNOWN;
+		this->activeUnit = UNKNOWN;
+		for (unsigned i = 0; i < MAX_TEXTURE_UNITS; i++) {
+			this->textures[i] = UNKNOWN;
+			this->textureTargets[i] = UNKNOWN;
+			this->samplers[i] = UNKNOWN;
+		}
+
+		this->blend = UNKNOWN;
+		this->cullFace = UNKNOWN;
+		this->depthTest = UNKNOWN;
+
+		this->blendSrc = this->blendDst = UNKNOWN;
+		this->cullMode = UNKNOWN;
+		this->depthFunction = UNKNOWN;
+		this->depthWrite = UNKNOWN;
+		this->polygonFill = UNKNOWN;
+	}
+
+	// Programs and vertex arrays
+	void useProgram(GLuint program) {
+		if (this->changed(this->program != program)) {
+			glUseProgram(program);
+			this->program = program;
+		}
+	}
+
+	void bindVertexArray(GLuint VAO) {
+		if (this->changed(this->VAO != VAO)) {
+			glBindVertexArray(VAO);
+			this->VAO = VAO;
+		}
+	}
+
+	// Textures, unit is zero based
+	void bindTexture(GLuint unit, GLenum target, GLuint texture) {
+		if (unit >= MAX_TEXTURE_UNITS) {
+			glActiveTexture(GL_TEXTURE0 + unit);
+			glBindTexture(target, texture);
+			this->activeUnit = unit;
+			return;
+		}
+		if (this->changed(this->textures[unit] != texture || this->textureTargets[unit] != target)) {
+			if (this->changed(this->activeUnit != unit)) {
+				glActiveTexture(GL_TEXTURE0 + unit);
+				this->activeUnit = unit;
+			}
+			glBindTexture(target, texture);
+			this->textures[unit] = texture;
+			this->textureTargets[unit] = target;
+		}
+	}
+
+	// Sampler objects override the parameters of the texture on the same unit
+	void bindSampler(GLuint unit, GLuint sampler) {
+		if (unit >= MAX_TEXTURE_UNITS) {
+			glBindSampler(unit, sampler);
+			return;
+		}
+		if (this->changed(this->samplers[unit] != sampler)) {
+			glBindSampler(unit, sampler);
+			this->samplers[unit] = sampler;
+		}
+	}
+
+	// Fixed function state
+	void enable(GLenum cap) {
+		this->setCapability(cap, true);
+	}
+
+	void disable(GLenum cap) {
+		this->setCapability(cap, false);
+	}
+
+	void blendFunc(GLenum src, GLenum dst) {
+		if (this->changed(this->blendSrc != src || this->blendDst != dst)) {
+			glBlendFunc(src, dst);
+			this->blendSrc = src;
+			this->blendDst = dst;
+		}
+	}
+
+	void cullFaceMode(GLenum mode) {
+		if (this->changed(this->cullMode != mode)) {
+			glCullFace(mode);
+			this->cullMode = mode;
+		}
+	}
+
+	void depthFunc(GLenum func) {
+		if (this->changed(this->depthFunction != func)) {
+			glDepthFunc(func);
+			this->depthFunction = func;
+		}
+	}
+
+	void depthMask(GLboolean write) {
+		if (this->changed(this->depthWrite != write)) {
+			glDepthMask(write);
+			this->depthWrite = write;
+		}
+	}
+
+	void polygonMode(GLenum mode) {
+		if (this->changed(this->polygonFill != mode)) {
+			glPolygonMode(GL_FRONT_AND_BACK, mode);
+			this->polygonFill = mode;
+		}
+	}
+
+	// Call once per frame, keeps the counts of the finished frame for report
+	void endFrame() {
+#ifdef _DEBUG
+		this->frameIssued = this->issued;
+		this->frameElided = this->elided;
+		this->issued = 0;
+		this->elided = 0;
+#endif
+	}
+
+	// Print the elided calls of the last frame, counted in Debug builds only
+	void report() const {
+#ifdef _DEBUG
+		std::cout << "GL state : " << this->frameElided << " of " << this->frameIssued + this->frameElided << " calls elided" << std::endl;
+#else
+		std::cout << "GL state : calls are only counted in Debug builds" << std::endl;
+#endif
+	}
+};
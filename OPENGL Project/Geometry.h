@@ -0,0 +1,431 @@
+#pragma once
+
+#include<iostream>
+#include<string>
+#include<memory>
+#include<unordered_map>
+#include<vector>
+#include<cfloat>
+
+#include<glew.h>
+#include<glfw3.h>
+
+#include"Primitives.h"
+#include"Vertex.h"
+#include"VertexLayout.h"
+#include"MeshOptimizer.h"
+#include"Bounds.h"
+#include"GLState.h"
+
+// Immutable GL buffer filled once from memory, several geometries may read from it
+class GeometryBuffer {
+private:
+	GLuint id;
+	GLsizeiptr size;
+
+public:
+	// Constructor, data is copied by the driver straight into the new storage
+	GeometryBuffer(const void* data, GLsizeiptr size) {
+		this->size = size;
+		glGenBuffers(1, &this->id);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, this->id);
+		glBufferStorage(GL_COPY_WRITE_BUFFER, size, data, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	// Destructor
+	~GeometryBuffer() {
+		glDeleteBuffers(1, &this->id);
+	}
+
+	GeometryBuffer(const GeometryBuffer&) = delete;
+	GeometryBuffer& operator=(const GeometryBuffer&) = delete;
+
+	// Getters
+	inline GLuint getId() const {
+		return this->id;
+	}
+
+	inline GLsizeiptr getSize() const {
+		return this->size;
+	}
+};
+
+// One vertex attribute read from offset in buffer, stride bytes apart
+struct GeometryAttribute {
+	GLuint location;
+	GLint size;
+	GLenum type;
+	GLboolean normalized;
+	std::shared_ptr<GeometryBuffer> buffer;
+	GLintptr offset;
+	GLsizei stride;
+};
+
+// Vertex and index streams already in a layout the GPU reads, uploaded without conversion
+// Positions and indices are also kept on the CPU for ray tests, and for bounds unless those are given
+struct GeometryStreams {
+	GLenum mode;
+	unsigned nVertices;
+	std::vector<GeometryAttribute> attributes;
+
+	// Layout of the attributes, FULL for float streams from other sources
+	VertexFormat format;
+
+	// No index buffer for unindexed draws
+	std::shared_ptr<GeometryBuffer> indexBuffer;
+	GLintptr indexOffset;
+	GLenum indexType;
+	unsigned nIndices;
+
+	std::vector<glm::vec3> positions;
+	std::vector<GLuint> indices;
+
+	AABB bounds;
+	BoundingSphere sphere;
+
+	GeometryStreams() : mode(GL_TRIANGLES), nVertices(0), format(VERTEX_FORMAT_FULL), indexOffset(0), indexType(GL_UNSIGNED_INT), nIndices(0) {
+
+	}
+};
+
+// GPU side vertex and index buffers of one primitive, shared by every Mesh using it
+class Geometry {
+private:
+	unsigned nVertices, nIndices;
+	GLuint VAO, VBO, EBO;
+	GLenum mode;
+	VertexFormat format;
+
+	// GL_UNSIGNED_SHORT whenever every vertex can be addressed with 16 bits
+	GLenum indexType;
+	GLintptr indexOffset;
+
+	// Buffers of streamed geometry, possibly shared with other geometries of the same file
+	std::vector<std::shared_ptr<GeometryBuffer> > sharedBuffers;
+
+	// Local bounds of the primitive
+	AABB bounds;
+	BoundingSphere sphere;
+
+	// CPU copy of positions and indices for exact ray tests
+	std::vector<glm::vec3> positions;
+	std::vector<GLuint> indices;
+
+	// Init Vertex Array with given promitive, vertices are converted to layout on upload
+	void initVAO(Primitive* primitive, const VertexLayout& layout) {
+		this->nVertices = primitive->getNvertices();
+		this->nIndices = primitive->getNindices();
+		this->indexOffset = 0;
+
+		std::vector<unsigned char> vertexData;
+		layout.encode(primitive->getVertices(), this->nVertices, vertexData);
+
+		glGenVertexArrays(1, &this->VAO);
+		glBindVertexArray(this->VAO);
+
+		glGenBuffers(1, &this->VBO);
+		glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+		glBufferData(GL_ARRAY_BUFFER, vertexData.size(), vertexData.data(), GL_STATIC_DRAW);
+
+		glGenBuffers(1, &this->EBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
+		this->indexType = this->nVertices <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		if (this->indexType == GL_UNSIGNED_SHORT) {
+			std::vector<GLushort> shortIndices(primitive->getIndices(), primitive->getIndices() + this->nIndices);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->nIndices * sizeof(GLushort), shortIndices.data(), GL_STATIC_DRAW);
+		}
+		else {
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->nIndices * sizeof(GLuint), primitive->getIndices(), GL_STATIC_DRAW);
+		}
+
+		// Vertex stream, POSITION COLOR TEX COORD NORMAL as described by the layout
+		glBindVertexBuffer(VERTEX_BINDING, this->VBO, 0, layout.getStride());
+		layout.apply(VERTEX_BINDING);
+
+		this->initInstanceAttributes();
+		glBindVertexArray(0);
+	}
+
+	// Init Vertex Array reading each attribute where the streams put it
+	// Attributes interleaved in one buffer share a binding, the others get one each
+	void initVAO(const GeometryStreams& streams) {
+		this->nVertices = streams.nVertices;
+		this->nIndices = streams.indexBuffer ? streams.nIndices : 0;
+		this->indexType = streams.indexType;
+		this->indexOffset = streams.indexOffset;
+
+		glGenVertexArrays(1, &this->VAO);
+		glBindVertexArray(this->VAO);
+
+		if (streams.indexBuffer) {
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, streams.indexBuffer->getId());
+			this->sharedBuffers.push_back(streams.indexBuffer);
+		}
+
+		std::vector<const GeometryAttribute*> bindings;
+		for (size_t i = 0; i < streams.attributes.size(); i++) {
+			const GeometryAttribute& attribute = streams.attributes[i];
+			size_t binding = 0;
+			while (binding < bindings.size() && !(bindings[binding]->buffer == attribute.buffer
+				&& bindings[binding]->stride == attribute.stride && attribute.offset >= bindings[binding]->offset
+				&& attribute.offset < bindings[binding]->offset + attribute.stride)) {
+				binding++;
+			}
+			if (binding == bindings.size()) {
+				bindings.push_back(&attribute);
+				glBindVertexBuffer(STREAM_BINDING + static_cast<GLuint>(binding), attribute.buffer->getId(), attribute.offset, attribute.stride);
+				this->sharedBuffers.push_back(attribute.buffer);
+			}
+			GLuint relativeOffset = static_cast<GLuint>(attribute.offset - bindings[binding]->offset);
+			glVertexAttribFormat(attribute.location, attribute.size, attribute.type, attribute.normalized, relativeOffset);
+			glVertexAttribBinding(attribute.location, STREAM_BINDING + static_cast<GLuint>(binding));
+			glEnableVertexAttribArray(attribute.location);
+		}
+
+		this->initInstanceAttributes();
+		glBindVertexArray(0);
+	}
+
+	// Per instance attributes of the bound VAO, the instance buffer is bound at draw time
+	void initInstanceAttributes() {
+		// MODEL MATRIX, one column per location, buffer is bound at draw time
+		for (GLuint column = 0; column < 4; column++) {
+			glVertexAttribFormat(INSTANCE_MODEL_LOCATION + column, 4, GL_FLOAT, GL_FALSE, column * sizeof(glm::vec4));
+			glVertexAttribBinding(INSTANCE_MODEL_LOCATION + column, INSTANCE_BINDING);
+			glEnableVertexAttribArray(INSTANCE_MODEL_LOCATION + column);
+		}
+
+		// OBJECT ID
+		glVertexAttribIFormat(INSTANCE_ID_LOCATION, 1, GL_UNSIGNED_INT, offsetof(InstanceData, ObjectId));
+		glVertexAttribBinding(INSTANCE_ID_LOCATION, INSTANCE_BINDING);
+		glEnableVertexAttribArray(INSTANCE_ID_LOCATION);
+
+		// MATERIAL INDEX
+		glVertexAttribIFormat(INSTANCE_MATERIAL_LOCATION, 1, GL_UNSIGNED_INT, offsetof(InstanceData, MaterialIndex));
+		glVertexAttribBinding(INSTANCE_MATERIAL_LOCATION, INSTANCE_BINDING);
+		glEnableVertexAttribArray(INSTANCE_MATERIAL_LOCATION);
+		glVertexBindingDivisor(INSTANCE_BINDING, 1);
+	}
+
+public:
+	// Constructors
+	Geometry(Primitive* primitive, VertexFormat format = DEFAULT_VERTEX_FORMAT) {
+		this->format = format;
+		this->initVAO(primitive, VertexLayout(format));
+		this->bounds = primitive->getBounds();
+		this->sphere = primitive->getSphere();
+
+		this->positions.resize(this->nVertices);
+		for (unsigned i = 0; i < this->nVertices; i++) {
+			this->positions[i] = primitive->getVertices()[i].position;
+		}
+		this->indices.assign(primitive->getIndices(), primitive->getIndices() + this->nIndices);
+
+		// Two vertex primitives are lines, everything else is triangles
+		this->mode = this->nVertices == 2 ? GL_LINES : GL_TRIANGLES;
+	}
+
+	// Streams already in GPU layout, normals are either float or packed with w = 0
+	Geometry(const GeometryStreams& streams) {
+		this->VBO = 0;
+		this->EBO = 0;
+		this->format = streams.format;
+		this->mode = streams.mode;
+		this->initVAO(streams);
+		this->positions = streams.positions;
+		this->indices = streams.indices;
+
+		if (streams.bounds.valid()) {
+			this->bounds = streams.bounds;
+			this->sphere = streams.sphere;
+			return;
+		}
+		for (size_t i = 0; i < this->positions.size(); i++) {
+			this->bounds.expand(this->positions[i]);
+		}
+		this->sphere = BoundingSphere(this->bounds.valid() ? this->bounds.center() : glm::vec3(0.f), 0.f);
+		for (size_t i = 0; i < this->positions.size(); i++) {
+			this->sphere.radius = glm::max(this->sphere.radius, glm::length(this->positions[i] - this->sphere.center));
+		}
+	}
+
+	// Destructors
+	~Geometry() {
+		glDeleteVertexArrays(1, &this->VAO);
+		glDeleteBuffers(1, &this->VBO);
+		glDeleteBuffers(1, &this->EBO);
+	}
+
+	// Not copyable, owns GL objects
+	Geometry(const Geometry&) = delete;
+	Geometry& operator=(const Geometry&) = delete;
+
+	// Draw count instances with whatever program and textures are bound
+	// Instance data is read from instanceBuffer starting at offset bytes
+	void drawInstanced(GLStateCache& state, GLuint instanceBuffer, GLintptr offset, GLsizei count) {
+		state.bindVertexArray(this->VAO);
+		glBindVertexBuffer(INSTANCE_BINDING, instanceBuffer, offset, sizeof(InstanceData));
+
+		if (this->nIndices == 0) {
+			glDrawArraysInstanced(this->mode, 0, this->nVertices, count);
+		}
+		else {
+			glDrawElementsInstanced(this->mode, this->nIndices, this->indexType, reinterpret_cast<const void*>(this->indexOffset), count);
+		}
+	}
+
+	// Closest triangle hit along a local space ray (Moller-Trumbore), both faces count
+	// Returns the ray parameter below tMax or -1 for a miss, lines never hit
+	float intersectRay(const glm::vec3& origin, const glm::vec3& direction, float tMax) const {
+		if (this->mode != GL_TRIANGLES) {
+			return -1.f;
+		}
+		float best = -1.f;
+		size_t triangles = this->indices.empty() ? this->positions.size() / 3 : this->indices.size() / 3;
+		for (size_t i = 0; i < triangles; i++) {
+			const glm::vec3& v0 = this->positions[this->indices.empty() ? i * 3 : this->indices[i * 3]];
+			const glm::vec3& v1 = this->positions[this->indices.empty() ? i * 3 + 1 : this->indices[i * 3 + 1]];
+			const glm::vec3& v2 = this->positions[this->indices.empty() ? i * 3 + 2 : this->indices[i * 3 + 2]];
+
+			glm::vec3 edge1 = v1 - v0;
+			glm::vec3 edge2 = v2 - v0;
+			glm::vec3 p = glm::cross(direction, edge2);
+			float determinant = glm::dot(edge1, p);
+			if (std::fabs(determinant) < 1e-12f) {
+				continue;
+			}
+			float inverseDeterminant = 1.f / determinant;
+
+			glm::vec3 toOrigin = origin - v0;
+			float u = glm::dot(toOrigin, p) * inverseDeterminant;
+			if (u < 0.f || u > 1.f) {
+				continue;
+			}
+			glm::vec3 q = glm::cross(toOrigin, edge1);
+			float v = glm::dot(direction, q) * inverseDeterminant;
+			if (v < 0.f || u + v > 1.f) {
+				continue;
+			}
+			float t = glm::dot(edge2, q) * inverseDeterminant;
+			if (t >= 0.f && t < tMax) {
+				tMax = t;
+				best = t;
+			}
+		}
+		return best;
+	}
+
+	// Getters
+	inline GLuint getVAO() const {
+		return this->VAO;
+	}
+
+	inline GLenum getMode() const {
+		return this->mode;
+	}
+
+	inline VertexFormat getFormat() const {
+		return this->format;
+	}
+
+	inline GLenum getIndexType() const {
+		return this->indexType;
+	}
+
+	inline unsigned getNvertices() const {
+		return this->nVertices;
+	}
+
+	inline unsigned getNindices() const {
+		return this->nIndices;
+	}
+
+	inline const AABB& getBounds() const {
+		return this->bounds;
+	}
+
+	inline const BoundingSphere& getSphere() const {
+		return this->sphere;
+	}
+};
+
+// Hands out shared geometry keyed by primitive type or asset ID
+// Entries are weak, buffers are freed when the last Mesh using them goes away
+class GeometryRegistry {
+private:
+	std::unordered_map<std::string, std::weak_ptr<Geometry>> entries;
+	VertexFormat format;
+
+public:
+	// Constructor, every geometry added is converted to format
+	GeometryRegistry(VertexFormat format = DEFAULT_VERTEX_FORMAT) {
+		this->format = format;
+	}
+
+	// Destructor
+	~GeometryRegistry() {
+
+	}
+
+	// Returns shared geometry for key, building it from a default constructed T on first use
+	template<typename T>
+	std::shared_ptr<Geometry> acquire(const std::string& key) {
+		std::shared_ptr<Geometry> geometry = this->find(key);
+		if (!geometry) {
+			T primitive = T();
+			geometry = this->add(key, &primitive);
+		}
+		return geometry;
+	}
+
+	// Returns shared geometry for key, building it from primitive on first use
+	std::shared_ptr<Geometry> acquire(const std::string& key, Primitive* primitive) {
+		std::shared_ptr<Geometry> geometry = this->find(key);
+		if (!geometry) {
+			geometry = this->add(key, primitive);
+		}
+		return geometry;
+	}
+
+	// Returns live geometry for key or nullptr
+	std::shared_ptr<Geometry> find(const std::string& key) {
+		std::unordered_map<std::string, std::weak_ptr<Geometry>>::iterator it = this->entries.find(key);
+		if (it == this->entries.end()) {
+			return nullptr;
+		}
+		return it->second.lock();
+	}
+
+	// Reorders primitive for the vertex cache, uploads it and registers it under key
+	std::shared_ptr<Geometry> add(const std::string& key, Primitive* primitive) {
+		MeshOptimizer::optimize(primitive);
+		std::shared_ptr<Geometry> geometry = std::make_shared<Geometry>(primitive, this->format);
+		this->entries[key] = geometry;
+		return geometry;
+	}
+
+	// Uploads streams as they are and registers them under key
+	std::shared_ptr<Geometry> add(const std::string& key, const GeometryStreams& streams) {
+		std::shared_ptr<Geometry> geometry = std::make_shared<Geometry>(streams);
+		this->entries[key] = geometry;
+		return geometry;
+	}
+
+	inline VertexFormat getFormat() const {
+		return this->format;
+	}
+
+	// Drops entries whose geometry has been freed
+	void collect() {
+		std::unordered_map<std::string, std::weak_ptr<Geometry>>::iterator it = this->entries.begin();
+		while (it != this->entries.end()) {
+			if (it->second.expired()) {
+				it = this->entries.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+	}
+};
@@ -0,0 +1,694 @@
+#pragma once
+
+#include<iostream>
+#include<string>
+#include<vector>
+#include<memory>
+#include<functional>
+#include<cstring>
+#include<cstdint>
+
+#include<glew.h>
+#include<glm.hpp>
+#include<gtc/quaternion.hpp>
+#include<gtc/type_ptr.hpp>
+
+#include"MappedFile.h"
+#include"Json.h"
+#include"Geometry.h"
+#include"VertexLayout.h"
+#include"Material.h"
+#include"MaterialLibrary.h"
+#include"Texture.h"
+#include"TextureCache.h"
+#include"Sampler.h"
+#include"ThreadPool.h"
+
+// One drawable of the scene, a mesh primitive placed by a node
+struct GltfInstance {
+	std::shared_ptr<Geometry> geometry;
+	Material* material;
+	glm::mat4 world;
+};
+
+// glTF 2.0 binary (.glb) scene
+// The file is memory mapped and every buffer view an accessor reads is handed to the driver
+// straight from the mapping, accessors become VAO attributes with their own offsets and strides
+// Materials map their base color onto Material, embedded images are decoded on the pool
+// Primitives are registered under "file#mesh/primitive" so later imports share the buffers
+class GltfScene {
+public:
+	static const uint32_t GLB_MAGIC = 0x46546C67;
+	static const uint32_t CHUNK_JSON = 0x4E4F534A;
+	static const uint32_t CHUNK_BIN = 0x004E4942;
+
+private:
+	// Accessor resolved against its buffer view
+	struct Accessor {
+		const unsigned char* data;
+		int view;
+		GLintptr offset;
+		GLint size;
+		GLenum type;
+		GLboolean normalized;
+		GLsizei stride;
+		unsigned count;
+	};
+
+	std::string fileName;
+	std::string directory;
+	JsonValue document;
+	bool loaded;
+
+	// Bytes of every glTF buffer, the BIN chunk or a mapped external file
+	std::vector<const unsigned char*> bufferData;
+	std::vector<size_t> bufferSizes;
+	std::vector<std::unique_ptr<MappedFile> > externalBuffers;
+
+	// GL buffers of the views, uploaded on first use
+	std::vector<std::shared_ptr<GeometryBuffer> > views;
+
+	std::vector<Material*> materials;
+	std::vector<GltfInstance> instances;
+
+	GeometryRegistry* geometries;
+	MaterialLibrary* materialLibrary;
+	TextureCache* textureCache;
+	const Sampler* sampler;
+
+	static uint32_t readU32(const unsigned char* bytes) {
+		return static_cast<uint32_t>(bytes[0]) | static_cast<uint32_t>(bytes[1]) << 8
+			| static_cast<uint32_t>(bytes[2]) << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+	}
+
+	static GLsizei componentBytes(GLenum type) {
+		switch (type) {
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:
+			return 1;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+			return 2;
+		case GL_UNSIGNED_INT:
+		case GL_FLOAT:
+			return 4;
+		default:
+			return 0;
+		}
+	}
+
+	static GLint componentCount(const std::string& type) {
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		return 0;
+	}
+
+	// Resolve accessor index, false for sparse or out of bounds accessors
+	bool resolve(int index, Accessor& accessor) const {
+		const JsonValue& json = this->document["accessors"][static_cast<size_t>(index)];
+		const JsonValue& view = this->document["bufferViews"][static_cast<size_t>(json["bufferView"].asInt(-1))];
+		int buffer = view["buffer"].asInt(-1);
+		if (index < 0 || json.isNull() || view.isNull() || json.has("sparse")
+			|| buffer < 0 || static_cast<size_t>(buffer) >= this->bufferData.size()) {
+			return false;
+		}
+
+		// glTF component types share the values of the GL enums
+		accessor.type = static_cast<GLenum>(json["componentType"].asInt());
+		accessor.size = componentCount(json["type"].asString());
+		accessor.normalized = json["normalized"].asBool() ? GL_TRUE : GL_FALSE;
+		accessor.count = static_cast<unsigned>(json["count"].asNumber());
+		accessor.view = json["bufferView"].asInt();
+		accessor.offset = static_cast<GLintptr>(json["byteOffset"].asNumber());
+		GLsizei element = componentBytes(accessor.type) * accessor.size;
+		accessor.stride = view.has("byteStride") ? view["byteStride"].asInt() : element;
+		if (element == 0 || accessor.count == 0 || accessor.stride < element) {
+			return false;
+		}
+
+		size_t viewOffset = static_cast<size_t>(view["byteOffset"].asNumber());
+		size_t viewLength = static_cast<size_t>(view["byteLength"].asNumber());
+		size_t needed = static_cast<size_t>(accessor.offset) + static_cast<size_t>(accessor.stride) * (accessor.count - 1) + element;
+		if (viewOffset + viewLength > this->bufferSizes[buffer] || needed > viewLength) {
+			return false;
+		}
+		accessor.data = this->bufferData[buffer] + viewOffset + accessor.offset;
+		return true;
+	}
+
+	// GL buffer holding a whole view, filled from the mapping with no staging copy
+	std::shared_ptr<GeometryBuffer> view(int index) {
+		if (!this->views[index]) {
+			const JsonValue& view = this->document["bufferViews"][static_cast<size_t>(index)];
+			const unsigned char* bytes = this->bufferData[view["buffer"].asInt()] + static_cast<size_t>(view["byteOffset"].asNumber());
+			this->views[index] = std::make_shared<GeometryBuffer>(bytes, static_cast<GLsizeiptr>(view["byteLength"].asNumber()));
+		}
+		return this->views[index];
+	}
+
+	// Optional attribute accessor, false if present but in a layout the shaders can not read
+	bool optionalAccessor(const JsonValue& attributes, const char* semantic, unsigned nVertices, bool floatOnly,
+		Accessor& accessor, bool& present) const {
+		present = attributes.has(semantic);
+		if (!present) {
+			return true;
+		}
+		if (!this->resolve(attributes[semantic].asInt(), accessor) || accessor.count != nVertices
+			|| (accessor.type != GL_FLOAT && (floatOnly || !accessor.normalized))) {
+			std::cout << "ERROR : GltfScene::optionalAccessor - Unsupported " << semantic << " accessor in " << this->fileName << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	// Attribute read where the accessor lies in its uploaded view
+	GeometryAttribute mapAttribute(const Accessor& accessor, GLuint location) {
+		GeometryAttribute attribute = { location, accessor.size, accessor.type, accessor.normalized,
+			this->view(accessor.view), accessor.offset, accessor.stride };
+		return attribute;
+	}
+
+	// Attribute with the elements of accessor copied per corner into a tight buffer of its own
+	static GeometryAttribute gatherAttribute(const Accessor& accessor, GLuint location, const std::vector<GLuint>& corners) {
+		size_t element = static_cast<size_t>(componentBytes(accessor.type)) * accessor.size;
+		std::vector<unsigned char> bytes(corners.size() * element);
+		for (size_t i = 0; i < corners.size(); i++) {
+			std::memcpy(bytes.data() + i * element, accessor.data + static_cast<size_t>(corners[i]) * accessor.stride, element);
+		}
+		GeometryAttribute attribute = { location, accessor.size, accessor.type, accessor.normalized,
+			std::make_shared<GeometryBuffer>(bytes.data(), static_cast<GLsizeiptr>(bytes.size())), 0, static_cast<GLsizei>(element) };
+		return attribute;
+	}
+
+	// Corners of a triangle list from the vertices of a list, strip or fan
+	static std::vector<GLuint> triangleCorners(GLenum mode, const std::vector<GLuint>& vertices) {
+		std::vector<GLuint> corners;
+		if (mode == GL_TRIANGLES) {
+			corners.assign(vertices.begin(), vertices.begin() + vertices.size() / 3 * 3);
+			return corners;
+		}
+		for (size_t i = 0; i + 2 < vertices.size(); i++) {
+			if (mode == GL_TRIANGLE_FAN) {
+				corners.push_back(vertices[0]);
+				corners.push_back(vertices[i + 1]);
+				corners.push_back(vertices[i + 2]);
+			}
+			else {
+				// Every other strip triangle is flipped to keep the winding
+				corners.push_back(vertices[i + (i & 1)]);
+				corners.push_back(vertices[i + 1 - (i & 1)]);
+				corners.push_back(vertices[i + 2]);
+			}
+		}
+		return corners;
+	}
+
+	// Without NORMAL glTF asks for flat normals, triangles are de-indexed so each corner
+	// gets the normal of its face, the other attributes are copied per corner, false without any triangle
+	bool flattenTriangles(GeometryStreams& streams, const Accessor& position, const Accessor* texcoord, const Accessor* color) {
+		std::vector<GLuint> vertices = streams.indices;
+		if (vertices.empty()) {
+			vertices.resize(streams.nVertices);
+			for (unsigned i = 0; i < streams.nVertices; i++) {
+				vertices[i] = i;
+			}
+		}
+		std::vector<GLuint> corners = triangleCorners(streams.mode, vertices);
+		if (corners.empty()) {
+			return false;
+		}
+
+		std::vector<glm::vec3> positions(corners.size());
+		std::vector<glm::vec3> normals(corners.size());
+		for (size_t i = 0; i + 2 < corners.size(); i += 3) {
+			positions[i] = streams.positions[corners[i]];
+			positions[i + 1] = streams.positions[corners[i + 1]];
+			positions[i + 2] = streams.positions[corners[i + 2]];
+			glm::vec3 normal = glm::cross(positions[i + 1] - positions[i], positions[i + 2] - positions[i]);
+			float length = glm::length(normal);
+			// Degenerate triangles get any unit normal, never a zero one
+			normal = length > 0.f ? normal / length : glm::vec3(0.f, 1.f, 0.f);
+			normals[i] = normals[i + 1] = normals[i + 2] = normal;
+		}
+
+		streams.attributes.clear();
+		streams.attributes.push_back(gatherAttribute(position, POSITION_LOCATION, corners));
+		GeometryAttribute normalAttribute = { NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE,
+			std::make_shared<GeometryBuffer>(normals.data(), static_cast<GLsizeiptr>(normals.size() * sizeof(glm::vec3))), 0, sizeof(glm::vec3) };
+		streams.attributes.push_back(normalAttribute);
+		if (texcoord) {
+			streams.attributes.push_back(gatherAttribute(*texcoord, TEXCOORD_LOCATION, corners));
+		}
+		if (color) {
+			streams.attributes.push_back(gatherAttribute(*color, COLOR_LOCATION, corners));
+		}
+
+		streams.mode = GL_TRIANGLES;
+		streams.nVertices = static_cast<unsigned>(corners.size());
+		streams.positions.swap(positions);
+		streams.indices.clear();
+		streams.indexBuffer.reset();
+		streams.nIndices = 0;
+		streams.indexOffset = 0;
+		return true;
+	}
+
+	// Geometry of one mesh primitive, nullptr if it can not be drawn
+	std::shared_ptr<Geometry> loadPrimitive(const JsonValue& primitive, const std::string& key) {
+		std::shared_ptr<Geometry> geometry = this->geometries->find(key);
+		if (geometry) {
+			return geometry;
+		}
+
+		GeometryStreams streams;
+		// glTF modes share the values of the GL enums, POINTS to TRIANGLE_FAN
+		int mode = primitive["mode"].asInt(4);
+		if (mode < 0 || mode > 6) {
+			return nullptr;
+		}
+		streams.mode = static_cast<GLenum>(mode);
+
+		const JsonValue& attributes = primitive["attributes"];
+		Accessor position;
+		if (!this->resolve(attributes["POSITION"].asInt(-1), position) || position.type != GL_FLOAT || position.size != 3) {
+			std::cout << "ERROR : GltfScene::loadPrimitive - Missing float POSITION in " << key << std::endl;
+			return nullptr;
+		}
+		streams.nVertices = position.count;
+		streams.positions.resize(position.count);
+		for (unsigned i = 0; i < position.count; i++) {
+			std::memcpy(&streams.positions[i], position.data + static_cast<size_t>(i) * position.stride, sizeof(glm::vec3));
+		}
+
+		// Normals stay float, the vertex shader tells them from packed ones by w
+		Accessor normal, texcoord, color;
+		bool hasNormal, hasTexcoord, hasColor;
+		if (!this->optionalAccessor(attributes, "NORMAL", position.count, true, normal, hasNormal)
+			|| !this->optionalAccessor(attributes, "TEXCOORD_0", position.count, false, texcoord, hasTexcoord)
+			|| !this->optionalAccessor(attributes, "COLOR_0", position.count, false, color, hasColor)) {
+			return nullptr;
+		}
+		if (!hasNormal && streams.mode < GL_TRIANGLES) {
+			std::cout << "ERROR : GltfScene::loadPrimitive - Points and lines without NORMAL are not supported in " << key << std::endl;
+			return nullptr;
+		}
+
+		if (primitive.has("indices")) {
+			Accessor indices;
+			if (!this->resolve(primitive["indices"].asInt(), indices) || indices.size != 1
+				|| componentBytes(indices.type) != indices.stride || indices.type == GL_FLOAT
+				|| indices.type == GL_BYTE || indices.type == GL_SHORT) {
+				std::cout << "ERROR : GltfScene::loadPrimitive - Unsupported indices in " << key << std::endl;
+				return nullptr;
+			}
+			streams.indices.resize(indices.count);
+			for (unsigned i = 0; i < indices.count; i++) {
+				GLuint index = indices.type == GL_UNSIGNED_BYTE ? indices.data[i]
+					: indices.type == GL_UNSIGNED_SHORT ? static_cast<GLuint>(indices.data[i * 2] | indices.data[i * 2 + 1] << 8)
+					: readU32(indices.data + i * 4);
+				if (index >= streams.nVertices) {
+					std::cout << "ERROR : GltfScene::loadPrimitive - Index out of range in " << key << std::endl;
+					return nullptr;
+				}
+				streams.indices[i] = index;
+			}
+			if (hasNormal) {
+				streams.indexBuffer = this->view(indices.view);
+				streams.indexOffset = indices.offset;
+				streams.indexType = indices.type;
+				streams.nIndices = indices.count;
+			}
+		}
+
+		if (!hasNormal) {
+			if (!this->flattenTriangles(streams, position, hasTexcoord ? &texcoord : nullptr, hasColor ? &color : nullptr)) {
+				std::cout << "ERROR : GltfScene::loadPrimitive - No triangle in " << key << std::endl;
+				return nullptr;
+			}
+			return this->geometries->add(key, streams);
+		}
+
+		// Zero copy, every attribute is read from its uploaded view
+		streams.attributes.push_back(this->mapAttribute(position, POSITION_LOCATION));
+		streams.attributes.push_back(this->mapAttribute(normal, NORMAL_LOCATION));
+		if (hasTexcoord) {
+			streams.attributes.push_back(this->mapAttribute(texcoord, TEXCOORD_LOCATION));
+		}
+		if (hasColor) {
+			streams.attributes.push_back(this->mapAttribute(color, COLOR_LOCATION));
+		}
+		return this->geometries->add(key, streams);
+	}
+
+	// Every image a material samples as base color, embedded ones decoded in parallel
+	std::vector<std::shared_ptr<Texture> > loadImages(ThreadPool* pool) {
+		const JsonValue& images = this->document["images"];
+		std::vector<std::shared_ptr<Texture> > textures(images.size());
+		std::vector<bool> used(images.size(), false);
+		const JsonValue& materials = this->document["materials"];
+		for (size_t i = 0; i < materials.size(); i++) {
+			int texture = materials[i]["pbrMetallicRoughness"]["baseColorTexture"]["index"].asInt(-1);
+			int source = this->document["textures"][static_cast<size_t>(texture)]["source"].asInt(-1);
+			if (source >= 0 && static_cast<size_t>(source) < images.size()) {
+				used[source] = true;
+			}
+		}
+
+		// Decoded pixels of embedded images, RGBA8
+		struct Decoded {
+			const unsigned char* bytes;
+			int length;
+			unsigned char* pixels;
+			int width, height;
+		};
+		std::vector<Decoded> decoded(images.size());
+		for (size_t i = 0; i < images.size(); i++) {
+			decoded[i].bytes = nullptr;
+			decoded[i].pixels = nullptr;
+			if (!used[i]) {
+				continue;
+			}
+			const JsonValue& image = images[i];
+			const std::string& uri = image["uri"].asString();
+			if (!uri.empty()) {
+				// Files next to the scene go through the cache and are streamed like any other texture
+				if (uri.compare(0, 5, "data:") == 0) {
+					std::cout << "ERROR : GltfScene::loadImages - Data URIs are not supported in " << this->fileName << std::endl;
+				}
+				else {
+					textures[i] = this->textureCache->acquire(this->directory + uri);
+				}
+				continue;
+			}
+			const JsonValue& view = this->document["bufferViews"][static_cast<size_t>(image["bufferView"].asInt(-1))];
+			int buffer = view["buffer"].asInt(-1);
+			size_t offset = static_cast<size_t>(view["byteOffset"].asNumber());
+			size_t length = static_cast<size_t>(view["byteLength"].asNumber());
+			if (buffer >= 0 && static_cast<size_t>(buffer) < this->bufferData.size() && offset + length <= this->bufferSizes[buffer]) {
+				decoded[i].bytes = this->bufferData[buffer] + offset;
+				decoded[i].length = static_cast<int>(length);
+			}
+		}
+
+		std::function<void(size_t, size_t)> decode = [&decoded](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				if (decoded[i].bytes) {
+					int channels;
+					decoded[i].pixels = SOIL_load_image_from_memory(decoded[i].bytes, decoded[i].length,
+						&decoded[i].width, &decoded[i].height, &channels, SOIL_LOAD_RGBA);
+				}
+			}
+		};
+		size_t embedded = 0;
+		for (size_t i = 0; i < decoded.size(); i++) {
+			embedded += decoded[i].bytes ? 1 : 0;
+		}
+		if (embedded > 1) {
+			ThreadPool* workers = pool;
+			std::unique_ptr<ThreadPool> ownPool;
+			if (!workers) {
+				ownPool.reset(new ThreadPool());
+				workers = ownPool.get();
+			}
+			workers->parallelFor(decoded.size(), decode);
+		}
+		else {
+			decode(0, decoded.size());
+		}
+
+		for (size_t i = 0; i < decoded.size(); i++) {
+			if (!decoded[i].bytes) {
+				continue;
+			}
+			if (!decoded[i].pixels) {
+				std::cout << "ERROR : GltfScene::loadImages - Could not decode image " << i << " of " << this->fileName << std::endl;
+				continue;
+			}
+			textures[i] = std::make_shared<Texture>(GL_TEXTURE_2D);
+			textures[i]->upload(decoded[i].width, decoded[i].height, decoded[i].pixels);
+			textures[i]->setSampler(this->sampler);
+			SOIL_free_image_data(decoded[i].pixels);
+		}
+		return textures;
+	}
+
+	// New material from library, the first one when the library is full so meshes never get nullptr
+	Material* createMaterial(const std::string& key, glm::vec3 ambient, glm::vec3 diffuse, glm::vec3 specular,
+		std::shared_ptr<Texture> diffuseTexture, std::shared_ptr<Texture> specularTexture, bool blended) {
+		Material* material = this->materialLibrary->create(ambient, diffuse, specular, diffuseTexture, specularTexture, blended);
+		if (!material) {
+			return this->materialLibrary->get(0);
+		}
+		material->setTopLeftOrigin(true);
+		this->materialLibrary->setName(key, material);
+		return material;
+	}
+
+	// Base color factor and texture become the diffuse term, there is no specular map in metallic roughness
+	// so a white one is scaled by the smoothness
+	// Materials are registered under "file#material/index", importing the file again reuses them
+	void loadMaterials(ThreadPool* pool) {
+		const JsonValue& materials = this->document["materials"];
+		this->materials.assign(materials.size(), nullptr);
+		bool missing = false;
+		for (size_t i = 0; i < materials.size(); i++) {
+			this->materials[i] = this->materialLibrary->find(this->fileName + "#material/" + std::to_string(i));
+			missing = missing || !this->materials[i];
+		}
+		if (!missing) {
+			return;
+		}
+
+		std::vector<std::shared_ptr<Texture> > images = this->loadImages(pool);
+		std::shared_ptr<Texture> white = this->materialLibrary->getWhiteTexture();
+		for (size_t i = 0; i < materials.size(); i++) {
+			if (this->materials[i]) {
+				continue;
+			}
+			const JsonValue& pbr = materials[i]["pbrMetallicRoughness"];
+			glm::vec3 baseColor(1.f);
+			for (int c = 0; c < 3; c++) {
+				baseColor[c] = static_cast<float>(pbr["baseColorFactor"][static_cast<size_t>(c)].asNumber(1.0));
+			}
+			float roughness = static_cast<float>(pbr["roughnessFactor"].asNumber(1.0));
+
+			int texture = pbr["baseColorTexture"]["index"].asInt(-1);
+			int source = this->document["textures"][static_cast<size_t>(texture)]["source"].asInt(-1);
+			std::shared_ptr<Texture> diffuse = source >= 0 && static_cast<size_t>(source) < images.size() && images[source]
+				? images[source] : white;
+
+			this->materials[i] = this->createMaterial(this->fileName + "#material/" + std::to_string(i), baseColor * 0.1f, baseColor,
+				glm::vec3(0.5f * (1.f - roughness)), diffuse, white, materials[i]["alphaMode"].asString() == "BLEND");
+		}
+	}
+
+	// Material of primitive, primitives without one share a plain white material across every scene
+	Material* materialOf(const JsonValue& primitive) {
+		int index = primitive["material"].asInt(-1);
+		if (index >= 0 && static_cast<size_t>(index) < this->materials.size()) {
+			return this->materials[index];
+		}
+		Material* material = this->materialLibrary->find("gltf#default");
+		if (!material) {
+			std::shared_ptr<Texture> white = this->materialLibrary->getWhiteTexture();
+			material = this->createMaterial("gltf#default", glm::vec3(0.1f), glm::vec3(1.f), glm::vec3(0.f), white, white, false);
+		}
+		return material;
+	}
+
+	static glm::mat4 localMatrix(const JsonValue& node) {
+		if (node.has("matrix")) {
+			glm::mat4 matrix;
+			float* values = glm::value_ptr(matrix);
+			for (size_t i = 0; i < 16; i++) {
+				values[i] = static_cast<float>(node["matrix"][i].asNumber(i % 5 == 0 ? 1.0 : 0.0));
+			}
+			return matrix;
+		}
+		const JsonValue& t = node["translation"];
+		const JsonValue& r = node["rotation"];
+		const JsonValue& s = node["scale"];
+		glm::vec3 translation(t[0].asNumber(), t[1].asNumber(), t[2].asNumber());
+		glm::quat rotation(static_cast<float>(r[3].asNumber(1.0)), static_cast<float>(r[0].asNumber()),
+			static_cast<float>(r[1].asNumber()), static_cast<float>(r[2].asNumber()));
+		glm::vec3 scale(s[0].asNumber(1.0), s[1].asNumber(1.0), s[2].asNumber(1.0));
+		return glm::translate(glm::mat4(1.f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.f), scale);
+	}
+
+	// Walk the node hierarchy, one instance per primitive of every mesh reached
+	void loadNodes(const std::vector<std::vector<std::shared_ptr<Geometry> > >& meshes) {
+		const JsonValue& nodes = this->document["nodes"];
+		std::vector<int> roots;
+		const JsonValue& scene = this->document["scenes"][static_cast<size_t>(this->document["scene"].asInt(0))];
+		if (!scene.isNull()) {
+			for (size_t i = 0; i < scene["nodes"].size(); i++) {
+				roots.push_back(scene["nodes"][i].asInt(-1));
+			}
+		}
+		else {
+			// No scene, every node nobody claims as a child is a root
+			std::vector<bool> child(nodes.size(), false);
+			for (size_t i = 0; i < nodes.size(); i++) {
+				for (size_t c = 0; c < nodes[i]["children"].size(); c++) {
+					size_t index = static_cast<size_t>(nodes[i]["children"][c].asInt(-1));
+					if (index < child.size()) {
+						child[index] = true;
+					}
+				}
+			}
+			for (size_t i = 0; i < nodes.size(); i++) {
+				if (!child[i]) {
+					roots.push_back(static_cast<int>(i));
+				}
+			}
+		}
+
+		// Each node is visited once, cyclic files can not hang the import
+		std::vector<bool> visited(nodes.size(), false);
+		std::vector<std::pair<int, glm::mat4> > stack;
+		for (size_t i = 0; i < roots.size(); i++) {
+			stack.push_back(std::make_pair(roots[i], glm::mat4(1.f)));
+		}
+		while (!stack.empty()) {
+			int index = stack.back().first;
+			glm::mat4 parent = stack.back().second;
+			stack.pop_back();
+			if (index < 0 || static_cast<size_t>(index) >= nodes.size() || visited[index]) {
+				continue;
+			}
+			visited[index] = true;
+
+			const JsonValue& node = nodes[static_cast<size_t>(index)];
+			glm::mat4 world = parent * localMatrix(node);
+			int mesh = node["mesh"].asInt(-1);
+			if (mesh >= 0 && static_cast<size_t>(mesh) < meshes.size()) {
+				const JsonValue& primitives = this->document["meshes"][static_cast<size_t>(mesh)]["primitives"];
+				for (size_t p = 0; p < meshes[mesh].size(); p++) {
+					if (meshes[mesh][p]) {
+						GltfInstance instance = { meshes[mesh][p], this->materialOf(primitives[p]), world };
+						this->instances.push_back(instance);
+					}
+				}
+			}
+			for (size_t c = 0; c < node["children"].size(); c++) {
+				stack.push_back(std::make_pair(node["children"][c].asInt(-1), world));
+			}
+		}
+	}
+
+	void load(ThreadPool* pool) {
+		MappedFile file(this->fileName);
+		const unsigned char* bytes = file.getData();
+		if (!file.isOpen() || file.getSize() < 20 || readU32(bytes) != GLB_MAGIC || readU32(bytes + 4) != 2
+			|| readU32(bytes + 8) > file.getSize()) {
+			std::cout << "ERROR : GltfScene::load - Not a glTF 2.0 binary " << this->fileName << std::endl;
+			return;
+		}
+
+		// JSON chunk first, then an optional BIN chunk, unknown chunks are skipped
+		size_t length = readU32(bytes + 8);
+		const unsigned char* json = nullptr;
+		const unsigned char* bin = nullptr;
+		size_t jsonSize = 0, binSize = 0;
+		for (size_t offset = 12; offset + 8 <= length;) {
+			size_t chunkSize = readU32(bytes + offset);
+			uint32_t chunkType = readU32(bytes + offset + 4);
+			if (offset + 8 + chunkSize > length) {
+				break;
+			}
+			if (chunkType == CHUNK_JSON && !json) {
+				json = bytes + offset + 8;
+				jsonSize = chunkSize;
+			}
+			else if (chunkType == CHUNK_BIN && !bin) {
+				bin = bytes + offset + 8;
+				binSize = chunkSize;
+			}
+			offset += 8 + ((chunkSize + 3) & ~static_cast<size_t>(3));
+		}
+		if (!json || !JsonValue::parse(reinterpret_cast<const char*>(json), reinterpret_cast<const char*>(json) + jsonSize, this->document)) {
+			std::cout << "ERROR : GltfScene::load - Invalid JSON chunk in " << this->fileName << std::endl;
+			return;
+		}
+		const JsonValue& required = this->document["extensionsRequired"];
+		if (required.size() > 0) {
+			std::cout << "ERROR : GltfScene::load - Required extension " << required[0].asString() << " is not supported" << std::endl;
+			return;
+		}
+
+		// Buffer 0 without uri is the BIN chunk, others are files next to the scene
+		const JsonValue& buffers = this->document["buffers"];
+		for (size_t i = 0; i < buffers.size(); i++) {
+			const std::string& uri = buffers[i]["uri"].asString();
+			size_t declared = static_cast<size_t>(buffers[i]["byteLength"].asNumber());
+			const unsigned char* data = nullptr;
+			size_t size = 0;
+			if (uri.empty() && i == 0 && bin) {
+				data = bin;
+				size = binSize;
+			}
+			else if (!uri.empty() && uri.compare(0, 5, "data:") != 0) {
+				this->externalBuffers.push_back(std::unique_ptr<MappedFile>(new MappedFile(this->directory + uri)));
+				data = this->externalBuffers.back()->getData();
+				size = this->externalBuffers.back()->getSize();
+			}
+			if (!data || size < declared) {
+				std::cout << "ERROR : GltfScene::load - Buffer " << i << " of " << this->fileName << " is missing" << std::endl;
+				return;
+			}
+			this->bufferData.push_back(data);
+			this->bufferSizes.push_back(declared);
+		}
+		this->views.resize(this->document["bufferViews"].size());
+
+		this->loadMaterials(pool);
+
+		const JsonValue& meshes = this->document["meshes"];
+		std::vector<std::vector<std::shared_ptr<Geometry> > > geometry(meshes.size());
+		for (size_t m = 0; m < meshes.size(); m++) {
+			const JsonValue& primitives = meshes[m]["primitives"];
+			for (size_t p = 0; p < primitives.size(); p++) {
+				std::string key = this->fileName + "#" + std::to_string(m) + "/" + std::to_string(p);
+				geometry[m].push_back(this->loadPrimitive(primitives[p], key));
+			}
+		}
+		this->loadNodes(geometry);
+
+		// The mapping goes away with this scope, nothing may point into it
+		this->bufferData.clear();
+		this->externalBuffers.clear();
+		this->views.clear();
+		this->loaded = true;
+	}
+
+public:
+	// Constructor, check isLoaded, pool is borrowed for image decoding, without one a pool is made when needed
+	GltfScene(const std::string& fileName, GeometryRegistry* geometries, MaterialLibrary* materialLibrary,
+		TextureCache* textureCache, const Sampler* sampler, ThreadPool* pool = NULL) {
+		this->fileName = fileName;
+		size_t slash = fileName.find_last_of("/\\");
+		this->directory = slash == std::string::npos ? "" : fileName.substr(0, slash + 1);
+		this->loaded = false;
+		this->geometries = geometries;
+		this->materialLibrary = materialLibrary;
+		this->textureCache = textureCache;
+		this->sampler = sampler;
+		this->load(pool);
+	}
+
+	// Destructor
+	~GltfScene() {
+
+	}
+
+	// Getters
+	inline bool isLoaded() const {
+		return this->loaded;
+	}
+
+	inline const std::vector<GltfInstance>& getInstances() const {
+		return this->instances;
+	}
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include<glew.h>
+#include<glfw3.h>
+#include<glm.hpp>
+#include<vec3.hpp>
+
+#include"Shader.h"
+#include"GLState.h"
+
+// Infinite ground grid drawn procedurally with one fullscreen triangle
+// Grid size and density do not change the number of draw calls
+class Grid {
+private:
+	Shader* shader;
+	GLuint VAO;
+
+	GLint heightLocation;
+	GLint spacingLocation;
+	GLint fadeLocation;
+	GLint colorLocation;
+
+public:
+	float height;
+	float spacing;
+	float fadeDistance;
+	glm::vec3 color;
+
+	// Constructor
+	Grid(float height = -1.f, float spacing = 0.5f, float fadeDistance = 30.f, glm::vec3 color = glm::vec3(0.5f, 0.6f, 0.8f)) {
+		this->height = height;
+		this->spacing = spacing;
+		this->fadeDistance = fadeDistance;
+		this->color = color;
+
+		this->shader = new Shader("grid_vertex.glsl", "grid_fragment.glsl");
+		this->heightLocation = this->shader->getUniformLocation("gridHeight");
+		this->spacingLocation = this->shader->getUniformLocation("gridSpacing");
+		this->fadeLocation = this->shader->getUniformLocation("fadeDistance");
+		this->colorLocation = this->shader->getUniformLocation("gridColor");
+
+		// Core profile needs a bound VAO even without vertex attributes
+		glGenVertexArrays(1, &this->VAO);
+	}
+
+	// Destructor
+	~Grid() {
+		glDeleteVertexArrays(1, &this->VAO);
+		delete this->shader;
+	}
+
+	// Draw after opaque meshes so the faded lines blend over them
+	void render(GLStateCache& state) {
+		this->shader->setVec1f(this->height, this->heightLocation);
+		this->shader->setVec1f(this->spacing, this->spacingLocation);
+		this->shader->setVec1f(this->fadeDistance, this->fadeLocation);
+		this->shader->setVec3f(this->color, this->colorLocation);
+
+		this->shader->use(state);
+		state.bindVertexArray(this->VAO);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+};
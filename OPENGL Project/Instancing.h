@@ -0,0 +1,48 @@
+#pragma once
+
+#include<vector>
+
+#include<glew.h>
+#include<glfw3.h>
+
+#include"Vertex.h"
+
+// Growable GPU buffer holding the per-instance data of one frame
+class InstanceBuffer {
+private:
+	GLuint id;
+	GLsizeiptr capacity;
+
+public:
+	// Constructor
+	InstanceBuffer() {
+		this->capacity = 0;
+		glGenBuffers(1, &this->id);
+	}
+
+	// Destructor
+	~InstanceBuffer() {
+		glDeleteBuffers(1, &this->id);
+	}
+
+	// Upload this frame's instances, orphaning last frame's storage so the driver does not stall
+	void upload(const std::vector<InstanceData>& instances) {
+		GLsizeiptr size = instances.size() * sizeof(InstanceData);
+		glBindBuffer(GL_ARRAY_BUFFER, this->id);
+		if (size > this->capacity) {
+			while (this->capacity < size) {
+				this->capacity = this->capacity ? this->capacity * 2 : 64 * sizeof(InstanceData);
+			}
+		}
+		glBufferData(GL_ARRAY_BUFFER, this->capacity, NULL, GL_STREAM_DRAW);
+		if (size > 0) {
+			glBufferSubData(GL_ARRAY_BUFFER, 0, size, instances.data());
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	// Getters
+	inline GLuint getId() const {
+		return this->id;
+	}
+};
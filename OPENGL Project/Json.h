@@ -0,0 +1,347 @@
+#pragma once
+
+#include<string>
+#include<vector>
+#include<utility>
+#include<cstdlib>
+#include<cstring>
+
+// Minimal read only JSON document, enough for asset manifests like glTF
+// Lookups of missing members or items return a shared null value, so chains like
+// json["a"][0]["b"].asInt(-1) never fail
+class JsonValue {
+public:
+	enum Type {
+		JSON_NULL,
+		JSON_BOOL,
+		JSON_NUMBER,
+		JSON_STRING,
+		JSON_ARRAY,
+		JSON_OBJECT
+	};
+
+private:
+	Type type;
+	bool boolean;
+	double number;
+	std::string string;
+	std::vector<JsonValue> items;
+	std::vector<std::pair<std::string, JsonValue> > members;
+
+	// Recursive descent over [p, end), p is left after the parsed value
+	class Parser {
+	private:
+		const char* p;
+		const char* end;
+		int depth;
+
+		void skipSpaces() {
+			while (this->p < this->end && (*this->p == ' ' || *this->p == '\t' || *this->p == '\n' || *this->p == '\r')) {
+				this->p++;
+			}
+		}
+
+		bool literal(const char* word) {
+			size_t length = std::strlen(word);
+			if (static_cast<size_t>(this->end - this->p) < length || std::memcmp(this->p, word, length) != 0) {
+				return false;
+			}
+			this->p += length;
+			return true;
+		}
+
+		static void appendUtf8(std::string& out, unsigned codepoint) {
+			if (codepoint < 0x80) {
+				out += static_cast<char>(codepoint);
+			}
+			else if (codepoint < 0x800) {
+				out += static_cast<char>(0xC0 | (codepoint >> 6));
+				out += static_cast<char>(0x80 | (codepoint & 0x3F));
+			}
+			else if (codepoint < 0x10000) {
+				out += static_cast<char>(0xE0 | (codepoint >> 12));
+				out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+				out += static_cast<char>(0x80 | (codepoint & 0x3F));
+			}
+			else {
+				out += static_cast<char>(0xF0 | (codepoint >> 18));
+				out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+				out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+				out += static_cast<char>(0x80 | (codepoint & 0x3F));
+			}
+		}
+
+		bool hex4(unsigned& value) {
+			if (this->end - this->p < 4) {
+				return false;
+			}
+			value = 0;
+			for (int i = 0; i < 4; i++) {
+				char c = *this->p++;
+				value <<= 4;
+				if (c >= '0' && c <= '9') value |= c - '0';
+				else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+				else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+				else return false;
+			}
+			return true;
+		}
+
+		bool parseString(std::string& out) {
+			if (this->p >= this->end || *this->p != '"') {
+				return false;
+			}
+			this->p++;
+			while (this->p < this->end && *this->p != '"') {
+				char c = *this->p++;
+				if (c != '\\') {
+					out += c;
+					continue;
+				}
+				if (this->p >= this->end) {
+					return false;
+				}
+				char escape = *this->p++;
+				switch (escape) {
+				case '"': out += '"'; break;
+				case '\\': out += '\\'; break;
+				case '/': out += '/'; break;
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'n': out += '\n'; break;
+				case 'r': out += '\r'; break;
+				case 't': out += '\t'; break;
+				case 'u': {
+					unsigned codepoint;
+					if (!this->hex4(codepoint)) {
+						return false;
+					}
+					// Surrogate pair
+					if (codepoint >= 0xD800 && codepoint < 0xDC00 && this->literal("\\u")) {
+						unsigned low;
+						if (!this->hex4(low)) {
+							return false;
+						}
+						codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+					}
+					appendUtf8(out, codepoint);
+					break;
+				}
+				default:
+					return false;
+				}
+			}
+			if (this->p >= this->end) {
+				return false;
+			}
+			this->p++;
+			return true;
+		}
+
+		bool parseNumber(double& out) {
+			const char* start = this->p;
+			while (this->p < this->end && (std::strchr("+-.eE", *this->p) || (*this->p >= '0' && *this->p <= '9'))) {
+				this->p++;
+			}
+			if (this->p == start || this->p - start > 63) {
+				return false;
+			}
+			char digits[64];
+			std::memcpy(digits, start, this->p - start);
+			digits[this->p - start] = '\0';
+			char* parsedEnd = NULL;
+			out = std::strtod(digits, &parsedEnd);
+			return parsedEnd == digits + (this->p - start);
+		}
+
+	public:
+		Parser(const char* begin, const char* end) {
+			this->p = begin;
+			this->end = end;
+			this->depth = 0;
+		}
+
+		bool parseValue(JsonValue& value) {
+			this->skipSpaces();
+			if (this->p >= this->end || this->depth > 256) {
+				return false;
+			}
+			char c = *this->p;
+			if (c == '{') {
+				value.type = JSON_OBJECT;
+				this->p++;
+				this->depth++;
+				this->skipSpaces();
+				if (this->p < this->end && *this->p == '}') {
+					this->p++;
+					this->depth--;
+					return true;
+				}
+				for (;;) {
+					this->skipSpaces();
+					std::pair<std::string, JsonValue> member;
+					if (!this->parseString(member.first)) {
+						return false;
+					}
+					this->skipSpaces();
+					if (this->p >= this->end || *this->p != ':') {
+						return false;
+					}
+					this->p++;
+					if (!this->parseValue(member.second)) {
+						return false;
+					}
+					value.members.push_back(member);
+					this->skipSpaces();
+					if (this->p < this->end && *this->p == ',') {
+						this->p++;
+						continue;
+					}
+					if (this->p < this->end && *this->p == '}') {
+						this->p++;
+						this->depth--;
+						return true;
+					}
+					return false;
+				}
+			}
+			if (c == '[') {
+				value.type = JSON_ARRAY;
+				this->p++;
+				this->depth++;
+				this->skipSpaces();
+				if (this->p < this->end && *this->p == ']') {
+					this->p++;
+					this->depth--;
+					return true;
+				}
+				for (;;) {
+					value.items.push_back(JsonValue());
+					if (!this->parseValue(value.items.back())) {
+						return false;
+					}
+					this->skipSpaces();
+					if (this->p < this->end && *this->p == ',') {
+						this->p++;
+						continue;
+					}
+					if (this->p < this->end && *this->p == ']') {
+						this->p++;
+						this->depth--;
+						return true;
+					}
+					return false;
+				}
+			}
+			if (c == '"') {
+				value.type = JSON_STRING;
+				return this->parseString(value.string);
+			}
+			if (this->literal("true")) {
+				value.type = JSON_BOOL;
+				value.boolean = true;
+				return true;
+			}
+			if (this->literal("false")) {
+				value.type = JSON_BOOL;
+				value.boolean = false;
+				return true;
+			}
+			if (this->literal("null")) {
+				value.type = JSON_NULL;
+				return true;
+			}
+			value.type = JSON_NUMBER;
+			return this->parseNumber(value.number);
+		}
+
+		// Only whitespace may follow the document
+		bool atEnd() {
+			this->skipSpaces();
+			return this->p == this->end;
+		}
+	};
+
+	static const JsonValue& null() {
+		static const JsonValue value;
+		return value;
+	}
+
+public:
+	// Constructor, a null value
+	JsonValue() {
+		this->type = JSON_NULL;
+		this->boolean = false;
+		this->number = 0.0;
+	}
+
+	// Parse the document in [begin, end), false on malformed input
+	static bool parse(const char* begin, const char* end, JsonValue& document) {
+		document = JsonValue();
+		Parser parser(begin, end);
+		return parser.parseValue(document) && parser.atEnd();
+	}
+
+	// Member of an object, null if absent
+	const JsonValue& operator[](const char* key) const {
+		for (size_t i = 0; i < this->members.size(); i++) {
+			if (this->members[i].first == key) {
+				return this->members[i].second;
+			}
+		}
+		return null();
+	}
+
+	// Item of an array, null if out of range
+	const JsonValue& operator[](size_t index) const {
+		return index < this->items.size() ? this->items[index] : null();
+	}
+
+	// Same for int literals and indices read from the document, negative ones are out of range
+	const JsonValue& operator[](int index) const {
+		return index >= 0 ? (*this)[static_cast<size_t>(index)] : null();
+	}
+
+	// Getters
+	inline Type getType() const {
+		return this->type;
+	}
+
+	inline bool isNull() const {
+		return this->type == JSON_NULL;
+	}
+
+	inline bool has(const char* key) const {
+		return !(*this)[key].isNull();
+	}
+
+	// Items of an array, members of an object
+	inline size_t size() const {
+		return this->type == JSON_OBJECT ? this->members.size() : this->items.size();
+	}
+
+	inline const std::string& getKey(size_t index) const {
+		return this->members[index].first;
+	}
+
+	inline const JsonValue& getMember(size_t index) const {
+		return this->members[index].second;
+	}
+
+	double asNumber(double fallback = 0.0) const {
+		return this->type == JSON_NUMBER ? this->number : fallback;
+	}
+
+	int asInt(int fallback = 0) const {
+		return this->type == JSON_NUMBER ? static_cast<int>(this->number) : fallback;
+	}
+
+	bool asBool(bool fallback = false) const {
+		return this->type == JSON_BOOL ? this->boolean : fallback;
+	}
+
+	const std::string& asString() const {
+		static const std::string empty;
+		return this->type == JSON_STRING ? this->string : empty;
+	}
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include<iostream>
+#include<string>
+#include<cstddef>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include<windows.h>
+#else
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<fcntl.h>
+#include<unistd.h>
+#endif
+
+// Read only memory mapping of a whole file, pages are loaded by the OS on first touch
+class MappedFile {
+private:
+	const unsigned char* bytes;
+	size_t size;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int file;
+#endif
+
+	void close() {
+#ifdef _WIN32
+		if (this->bytes) {
+			UnmapViewOfFile(this->bytes);
+		}
+		if (this->mapping) {
+			CloseHandle(this->mapping);
+		}
+		if (this->file != INVALID_HANDLE_VALUE) {
+			CloseHandle(this->file);
+		}
+		this->mapping = NULL;
+		this->file = INVALID_HANDLE_VALUE;
+#else
+		if (this->bytes) {
+			munmap(const_cast<unsigned char*>(this->bytes), this->size);
+		}
+		if (this->file >= 0) {
+			::close(this->file);
+		}
+		this->file = -1;
+#endif
+		this->bytes = nullptr;
+		this->size = 0;
+	}
+
+public:
+	// Constructor, check isOpen, empty files are not mapped
+	MappedFile(const std::string& fileName) {
+		this->bytes = nullptr;
+		this->size = 0;
+#ifdef _WIN32
+		this->mapping = NULL;
+		this->file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		LARGE_INTEGER fileSize;
+		if (this->file == INVALID_HANDLE_VALUE || !GetFileSizeEx(this->file, &fileSize) || fileSize.QuadPart == 0) {
+			this->close();
+			return;
+		}
+		this->mapping = CreateFileMappingA(this->file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (this->mapping) {
+			this->bytes = static_cast<const unsigned char*>(MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0));
+		}
+		if (!this->bytes) {
+			this->close();
+			return;
+		}
+		this->size = static_cast<size_t>(fileSize.QuadPart);
+#else
+		this->file = open(fileName.c_str(), O_RDONLY);
+		struct stat status;
+		if (this->file < 0 || fstat(this->file, &status) != 0 || status.st_size == 0) {
+			this->close();
+			return;
+		}
+		void* address = mmap(NULL, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, this->file, 0);
+		if (address == MAP_FAILED) {
+			this->close();
+			return;
+		}
+		this->bytes = static_cast<const unsigned char*>(address);
+		this->size = static_cast<size_t>(status.st_size);
+		// Parsed front to back, let the kernel read ahead
+		madvise(address, this->size, MADV_SEQUENTIAL);
+#endif
+	}
+
+	// Destructor
+	~MappedFile() {
+		this->close();
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Getters
+	inline bool isOpen() const {
+		return this->bytes != nullptr;
+	}
+
+	inline const unsigned char* getData() const {
+		return this->bytes;
+	}
+
+	inline size_t getSize() const {
+		return this->size;
+	}
+};
@@ -1,6 +1,8 @@
 #pragma once
 
 
+#include<memory>
+
 #include<glew.h>
 #include<glfw3.h>
 #include<glm.hpp>
@@ -11,28 +13,75 @@
 #include<gtc/matrix_transform.hpp>
 #include<gtc/type_ptr.hpp>
 
-#include"Shader.h"
+#include"Texture.h"
+#include"TextureArray.h"
+
+// Texture units of the diffuse and specular arrays, match layout(binding) in the fragment shaders
+enum MaterialTextureUnit {
+	DIFFUSE_UNIT = 0,
+	SPECULAR_UNIT = 1
+};
+
+// One entry of the MaterialBlock in the shaders, same layout under std140 and std430
+// vec3 values are stored as vec4 to match std140 alignment, ambient.w is 1 for top left texcoord origins
+// textures holds the diffuse and specular array layers in x and y,
+// or the two 64-bit bindless handles split into low and high words on the bindless path
+struct MaterialData {
+	glm::vec4 ambient;
+	glm::vec4 diffuse;
+	glm::vec4 specular;
+	glm::uvec4 textures;
+};
 
 
 class Material {
 private:
 	// Variables
+	// Index into the material block, also used in render sort keys
+	unsigned id;
+
+	// Drawn in the blended pass, back to front
+	bool blended;
+
+	// Texcoords of the meshes count v down from the top of the image, as in glTF
+	bool topLeftOrigin;
+
 	// Light Intensity
 	glm::vec3 ambient;
 	glm::vec3 diffuse;
 	glm::vec3 specular;
 
-	// Texture units
-	GLint diffuseTex;
-	GLint specularTex;
+	// Source images, released once copied into the arrays
+	std::shared_ptr<Texture> diffuseTexture;
+	std::shared_ptr<Texture> specularTexture;
+
+	// Arrays and layers the shaders sample
+	TextureArray* diffuseArray;
+	TextureArray* specularArray;
+	int diffuseLayer;
+	int specularLayer;
+
+	// Bindless texture handles, used instead of the arrays when both are set
+	GLuint64 diffuseHandle;
+	GLuint64 specularHandle;
 public:
-	// Constructor
-	Material(glm::vec3 ambient, glm::vec3 diffuse, glm::vec3 specular, GLint diffuseTex, GLint specularTex) {
+	// Constructor, usually called through MaterialLibrary::create
+	Material(unsigned id, glm::vec3 ambient, glm::vec3 diffuse, glm::vec3 specular,
+		std::shared_ptr<Texture> diffuseTexture, std::shared_ptr<Texture> specularTexture, bool blended = false) {
+		this->id = id;
+		this->blended = blended;
+		this->topLeftOrigin = false;
 		this->ambient = ambient;
 		this->diffuse = diffuse;
 		this->specular = specular;
-		this->diffuseTex = diffuseTex;
-		this->specularTex = specularTex;
+		this->diffuseTexture = diffuseTexture;
+		this->specularTexture = specularTexture;
+		this->diffuseArray = nullptr;
+		this->specularArray = nullptr;
+		this->diffuseLayer = 0;
+		this->specularLayer = 0;
+		this->diffuseHandle = 0;
+		this->specularHandle = 0;
 	}
 
 	// Destructor
@@ -40,26 +89,83 @@ public:
 		
 	}
 
-	// Unifrom Send to shader
-	void sendToShader(Shader& programId) {
-		programId.setVec3f(this->ambient, "material.ambient");
-		programId.setVec3f(this->diffuse, "material.diffuse");
-		programId.setVec3f(this->specular, "material.specular");
-		programId.set1i(this->diffuseTex, "material.diffuseTex");
-		programId.set1i(this->specularTex, "material.specularTex");
+	Material(const Material&) = delete;
+	Material& operator=(const Material&) = delete;
+
+	// Entry of the material block
+	MaterialData getData() const {
+		MaterialData data;
+		data.ambient = glm::vec4(this->ambient, this->topLeftOrigin ? 1.f : 0.f);
+		data.diffuse = glm::vec4(this->diffuse, 0.f);
+		data.specular = glm::vec4(this->specular, 0.f);
+		if (this->diffuseHandle && this->specularHandle) {
+			data.textures = glm::uvec4(
+				static_cast<GLuint>(this->diffuseHandle), static_cast<GLuint>(this->diffuseHandle >> 32),
+				static_cast<GLuint>(this->specularHandle), static_cast<GLuint>(this->specularHandle >> 32));
+		}
+		else {
+			data.textures = glm::uvec4(this->diffuseLayer, this->specularLayer, 0, 0);
+		}
+		return data;
 	}
 
 	// Getters
-	GLint getDiffuseTex() {
-		return diffuseTex;
+	inline unsigned getId() const {
+		return this->id;
+	}
+
+	inline bool isBlended() const {
+		return this->blended;
 	}
 
-	GLint getSpecTex() {
-		return specularTex;
+	// Both sources uploaded, ready to be copied into the arrays
+	bool isReady() const {
+		return this->diffuseTexture && this->specularTexture
+			&& this->diffuseTexture->isResident() && this->specularTexture->isResident();
+	}
+
+	// Sources already copied into the arrays, never true on the bindless path
+	inline bool isPacked() const {
+		return !this->diffuseTexture && !this->specularTexture;
+	}
+
+	inline const std::shared_ptr<Texture>& getDiffuseTexture() const {
+		return this->diffuseTexture;
+	}
+
+	inline const std::shared_ptr<Texture>& getSpecularTexture() const {
+		return this->specularTexture;
+	}
+
+	// Null on the bindless path
+	inline TextureArray* getDiffuseArray() const {
+		return this->diffuseArray;
+	}
+
+	inline TextureArray* getSpecularArray() const {
+		return this->specularArray;
 	}
 
 	// Setters
-	void changeTexture(GLint newTexture) {
-		this->diffuseTex = newTexture;
+	void setLayers(TextureArray* diffuseArray, int diffuseLayer, TextureArray* specularArray, int specularLayer) {
+		this->diffuseArray = diffuseArray;
+		this->diffuseLayer = diffuseLayer;
+		this->specularArray = specularArray;
+		this->specularLayer = specularLayer;
+	}
+
+	void setTopLeftOrigin(bool topLeftOrigin) {
+		this->topLeftOrigin = topLeftOrigin;
+	}
+
+	void setHandles(GLuint64 diffuseHandle, GLuint64 specularHandle) {
+		this->diffuseHandle = diffuseHandle;
+		this->specularHandle = specularHandle;
+	}
+
+	// Drop the source images, the cache may evict them afterwards
+	void releaseTextures() {
+		this->diffuseTexture.reset();
+		this->specularTexture.reset();
 	}
-};
\ No newline at end of file
+};
@@ -0,0 +1,272 @@
+#pragma once
+
+#include<iostream>
+#include<string>
+#include<vector>
+#include<memory>
+#include<unordered_map>
+
+#include<glew.h>
+
+#include"Sampler.h"
+#include"Texture.h"
+#include"TextureArray.h"
+#include"Material.h"
+#include"UniformBuffer.h"
+
+// Owns every material, the texture arrays their images are packed into and the material block
+// Images of the same size, format and level count share an array, so meshes with different
+// materials bind the same two arrays and can be drawn by one instanced call.
+// With ARB_bindless_texture the block is a storage buffer holding 64-bit texture handles instead,
+// nothing is bound per draw and every material batches together. Shaders pick the matching
+// declarations through getShaderDefines.
+// Until both images of a material are uploaded it samples a 1x1 grey placeholder
+class MaterialLibrary {
+public:
+	// Size of the materials array in the MaterialBlock of the shaders
+	enum : unsigned { MAX_MATERIALS = 256 };
+
+private:
+	const Sampler* sampler;
+	std::vector<Material*> materials;
+	std::vector<TextureArray*> arrays;
+	Texture* placeholderTexture;
+	TextureArray* placeholder;
+
+	// Materials of imported assets by asset key, so importing a file again reuses them
+	std::unordered_map<std::string, Material*> named;
+
+	// 1x1 white image for materials without a texture, made on first use
+	std::shared_ptr<Texture> whiteTexture;
+
+	std::vector<MaterialData> data;
+	UniformBuffer* buffer;
+	bool dirty;
+
+	// Bindless path
+	// Objects referenced by a handle can no longer be changed, so handles are built with a copy of
+	// the shared sampler. A copy made before the sampler changed is retired, not deleted, its handles stay valid
+	bool bindless;
+	Sampler* handleSampler;
+	unsigned handleSamplerVersion;
+	std::vector<Sampler*> retiredSamplers;
+	std::vector<GLuint64> residentHandles;
+	std::vector<bool> hasHandles;
+	GLuint64 placeholderHandle;
+
+	// Resident handle of texture filtered by the current sampler copy
+	GLuint64 makeHandle(const Texture& texture) {
+		GLuint64 handle = glGetTextureSamplerHandleARB(texture.getId(), this->handleSampler->getId());
+		if (!glIsTextureHandleResidentARB(handle)) {
+			glMakeTextureHandleResidentARB(handle);
+			this->residentHandles.push_back(handle);
+		}
+		return handle;
+	}
+
+	// Copy of the shared sampler state, every material falls back to the placeholder until its handles are rebuilt
+	void refreshHandleSampler() {
+		for (size_t i = 0; i < this->residentHandles.size(); i++) {
+			glMakeTextureHandleNonResidentARB(this->residentHandles[i]);
+		}
+		this->residentHandles.clear();
+		if (this->handleSampler) {
+			this->retiredSamplers.push_back(this->handleSampler);
+		}
+
+		this->handleSampler = new Sampler(this->sampler->getMinFilter(), this->sampler->getMagFilter(),
+			this->sampler->getWrap(), this->sampler->getAnisotropy());
+		this->handleSamplerVersion = this->sampler->getVersion();
+
+		this->placeholderHandle = this->makeHandle(*this->placeholderTexture);
+		for (size_t i = 0; i < this->materials.size(); i++) {
+			this->materials[i]->setHandles(this->placeholderHandle, this->placeholderHandle);
+			this->hasHandles[i] = false;
+		}
+		this->dirty = true;
+	}
+
+	// Give handles to materials whose images finished uploading
+	void updateHandles() {
+		if (this->sampler->getVersion() != this->handleSamplerVersion) {
+			this->refreshHandleSampler();
+		}
+		for (size_t i = 0; i < this->materials.size(); i++) {
+			Material* material = this->materials[i];
+			if (this->hasHandles[i] || !material->isReady()) {
+				continue;
+			}
+			material->setHandles(this->makeHandle(*material->getDiffuseTexture()), this->makeHandle(*material->getSpecularTexture()));
+			this->hasHandles[i] = true;
+			this->dirty = true;
+		}
+	}
+
+	// Copy materials whose images finished uploading into the arrays
+	void updateArrays() {
+		for (size_t i = 0; i < this->materials.size(); i++) {
+			Material* material = this->materials[i];
+			if (material->isPacked() || !material->isReady()) {
+				continue;
+			}
+			int diffuseLayer, specularLayer;
+			TextureArray* diffuseArray = this->pack(*material->getDiffuseTexture(), diffuseLayer);
+			TextureArray* specularArray = this->pack(*material->getSpecularTexture(), specularLayer);
+			material->setLayers(diffuseArray, diffuseLayer, specularArray, specularLayer);
+			material->releaseTextures();
+			this->dirty = true;
+		}
+	}
+
+	// Layer for texture in the first array that fits it, a new array if none does
+	TextureArray* pack(const Texture& texture, int& layer) {
+		TextureArray* target = nullptr;
+		for (size_t i = 0; i < this->arrays.size() && !target; i++) {
+			if (this->arrays[i]->accepts(texture)) {
+				target = this->arrays[i];
+			}
+		}
+		if (!target) {
+			target = new TextureArray(texture.getFormat(), texture.getWidth(), texture.getHeight(), texture.getLevels(), this->sampler);
+			this->arrays.push_back(target);
+		}
+		layer = target->append(texture);
+		return target;
+	}
+
+public:
+	// Whether the bindless path can be used, shaders and library have to agree on it
+	static bool isBindlessSupported() {
+		return GLEW_ARB_bindless_texture != 0;
+	}
+
+	// Defines compiling the material block of the shaders for the given path
+	static std::string getShaderDefines(bool bindless) {
+		return bindless ? "#define BINDLESS\n" : "";
+	}
+
+	// Constructor, bindless falls back to texture arrays when the extension is missing
+	MaterialLibrary(const Sampler* sampler, bool bindless = isBindlessSupported()) {
+		this->sampler = sampler;
+		this->dirty = true;
+		this->bindless = bindless && isBindlessSupported();
+		this->handleSampler = nullptr;
+		this->handleSamplerVersion = 0;
+		this->placeholderHandle = 0;
+		this->placeholder = nullptr;
+		this->data.resize(MAX_MATERIALS);
+		this->buffer = new UniformBuffer(MAX_MATERIALS * sizeof(MaterialData), MATERIAL_DATA_BINDING,
+			this->bindless ? GL_SHADER_STORAGE_BUFFER : GL_UNIFORM_BUFFER);
+
+		this->placeholderTexture = new Texture(GL_TEXTURE_2D);
+		if (this->bindless) {
+			this->refreshHandleSampler();
+		}
+		else {
+			this->placeholder = new TextureArray(GL_RGBA8, 1, 1, 1, sampler, 1);
+			this->placeholder->append(*this->placeholderTexture);
+		}
+	}
+
+	// Destructor
+	~MaterialLibrary() {
+		for (size_t i = 0; i < this->materials.size(); i++) {
+			delete this->materials[i];
+		}
+		for (size_t i = 0; i < this->arrays.size(); i++) {
+			delete this->arrays[i];
+		}
+		// Handles have to go before the objects they reference
+		for (size_t i = 0; i < this->residentHandles.size(); i++) {
+			glMakeTextureHandleNonResidentARB(this->residentHandles[i]);
+		}
+		for (size_t i = 0; i < this->retiredSamplers.size(); i++) {
+			delete this->retiredSamplers[i];
+		}
+		delete this->handleSampler;
+		delete this->placeholder;
+		delete this->placeholderTexture;
+		delete this->buffer;
+	}
+
+	MaterialLibrary(const MaterialLibrary&) = delete;
+	MaterialLibrary& operator=(const MaterialLibrary&) = delete;
+
+	// New material sampling the given images, nullptr once MAX_MATERIALS is reached
+	Material* create(glm::vec3 ambient, glm::vec3 diffuse, glm::vec3 specular,
+		std::shared_ptr<Texture> diffuseTexture, std::shared_ptr<Texture> specularTexture, bool blended = false) {
+		if (this->materials.size() >= MAX_MATERIALS) {
+			std::cout << "ERROR : MaterialLibrary::create - No more than " << MAX_MATERIALS << " materials" << std::endl;
+			return nullptr;
+		}
+		Material* material = new Material(static_cast<unsigned>(this->materials.size()), ambient, diffuse, specular,
+			diffuseTexture, specularTexture, blended);
+		if (this->bindless) {
+			material->setHandles(this->placeholderHandle, this->placeholderHandle);
+		}
+		else {
+			material->setLayers(this->placeholder, 0, this->placeholder, 0);
+		}
+		this->materials.push_back(material);
+		this->hasHandles.push_back(false);
+		this->dirty = true;
+		return material;
+	}
+
+	// Pack or resolve handles of materials whose images finished uploading and refresh the block, once per frame
+	// Packing may replace array objects, invalidate the state cache afterwards
+	void update() {
+		if (this->bindless) {
+			this->updateHandles();
+		}
+		else {
+			this->updateArrays();
+		}
+
+		if (this->dirty) {
+			for (size_t i = 0; i < this->materials.size(); i++) {
+				this->data[i] = this->materials[i]->getData();
+			}
+			this->buffer->update(this->data.data());
+			this->dirty = false;
+		}
+	}
+
+	// Material registered under key, nullptr if there is none
+	Material* find(const std::string& key) const {
+		std::unordered_map<std::string, Material*>::const_iterator it = this->named.find(key);
+		return it == this->named.end() ? nullptr : it->second;
+	}
+
+	void setName(const std::string& key, Material* material) {
+		this->named[key] = material;
+	}
+
+	// Shared white texture, resident right away
+	std::shared_ptr<Texture> getWhiteTexture() {
+		if (!this->whiteTexture) {
+			const unsigned char pixel[4] = { 255, 255, 255, 255 };
+			this->whiteTexture = std::make_shared<Texture>(GL_TEXTURE_2D);
+			this->whiteTexture->upload(1, 1, pixel);
+			this->whiteTexture->setSampler(this->sampler);
+		}
+		return this->whiteTexture;
+	}
+
+	// Getters
+	inline Material* get(size_t index) const {
+		return this->materials[index];
+	}
+
+	inline size_t size() const {
+		return this->materials.size();
+	}
+
+	inline bool isBindless() const {
+		return this->bindless;
+	}
+
+	inline size_t getArrayCount() const {
+		return this->arrays.size();
+	}
+};
@@ -2,179 +2,131 @@
 
 #include<iostream>
 #include<vector>
+#include<memory>
 
 #include"Primitives.h"
+#include"Geometry.h"
+#include"Transform.h"
 #include"Shader.h"
-#include"Texture.h"
 #include"Material.h"
 #include"Vertex.h"
 
+// Lightweight instance of shared geometry with a material and a slot in the transform store
 class Mesh {
 private:
-	unsigned nVertices, nIndices;
-	GLuint VAO, VBO, EBO;
-	Texture* diffuseTexture;
-	Texture* specTexture;
+	std::shared_ptr<Geometry> geometry;
 	Material* material;
-	glm::vec3 position;
-	glm::vec3 rotation;
-	glm::vec3 scale;
-	glm::mat4 ModelMatrix;
 
-
-	// Init Vertex Array with given promitive
-	void initVAO(Primitive* primitive) {
-		this->nVertices = primitive->getNvertices();
-		this->nIndices = primitive->getNindices();
-
-		glGenVertexArrays(1, &this->VAO);
-		glBindVertexArray(this->VAO);
-
-		glGenBuffers(1, &this->VBO);
-		glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-		glBufferData(GL_ARRAY_BUFFER, this->nVertices * sizeof(Vertex), primitive->getVertices(), GL_STATIC_DRAW);
-
-		glGenBuffers(1, &this->EBO);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->nIndices * sizeof(GLuint), primitive->getIndices(), GL_STATIC_DRAW);
-
-		// POSITION
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, position));
-		glEnableVertexAttribArray(0);
-
-		// COLOR
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, color));
-		glEnableVertexAttribArray(1);
-
-
-		// TEX COORD
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, texcoord));
-		glEnableVertexAttribArray(2);
-
-		// NORMAL
-		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, normal));
-		glEnableVertexAttribArray(3);
-
-
-		glBindVertexArray(0);
-	}
-
-
-	// Update Model Matrix uniform
-	void updateUniforms(Shader* shader) {
-		shader->setMat4fv(this->ModelMatrix, "ModelMatrix");
-	}
-
-	// Update Model Matrix using changed position, rotation and scale in each frame
-	void updateModelMatrix() {
-		this->ModelMatrix = glm::mat4(1.0f);
-		this->ModelMatrix = glm::translate(this->ModelMatrix, this->position);
-		this->ModelMatrix = glm::rotate(this->ModelMatrix, glm::radians(this->rotation.x), glm::vec3(1.f, 0.f, 0.f));
-		this->ModelMatrix = glm::rotate(this->ModelMatrix, glm::radians(this->rotation.y), glm::vec3(0.f, 1.f, 0.f));
-		this->ModelMatrix = glm::rotate(this->ModelMatrix, glm::radians(this->rotation.z), glm::vec3(0.f, 0.f, 1.f));
-		this->ModelMatrix = glm::scale(this->ModelMatrix, this->scale);
-	}
+	// Position, rotation, scale and model matrix live in the shared store
+	TransformStore* transforms;
+	TransformStore::Handle transform;
 
 public:
 	// Constructors
-	Mesh(Primitive* primitive, Texture* diffuse, Texture* spec, Material* mat,
+	// Shared geometry, usually handed out by GeometryRegistry
+	Mesh(TransformStore* transforms, std::shared_ptr<Geometry> geometry, Material* mat,
 		glm::vec3 position = glm::vec3(0.f), glm::vec3 rotation = glm::vec3(0.f), glm::vec3 scale = glm::vec3(1.f)) {
-		this->position = position;
-		this->rotation = rotation;
-		this->scale = scale;
+		this->transforms = transforms;
+		this->transform = transforms->create(position, rotation, scale);
 
-		this->diffuseTexture = diffuse;
-		this->specTexture = spec;
 		this->material = mat;
 
-		this->initVAO(primitive);
-		this->updateModelMatrix();
+		this->geometry = geometry;
+	}
+
+	// One-off geometry owned by this mesh only
+	Mesh(TransformStore* transforms, Primitive* primitive, Material* mat,
+		glm::vec3 position = glm::vec3(0.f), glm::vec3 rotation = glm::vec3(0.f), glm::vec3 scale = glm::vec3(1.f))
+		: Mesh(transforms, std::make_shared<Geometry>(primitive), mat, position, rotation, scale) {
+
 	}
 
 	// Destructors
 	~Mesh() {
-		glDeleteVertexArrays(1, &this->VAO);
-		glDeleteBuffers(1, &this->VBO);
-		glDeleteBuffers(1, &this->EBO);
-	}
-
-
-	// Render this shader program
-	void render(Shader* shader) {
-		// Send Material
-		this->material->sendToShader(*shader);
-		
-		// Update Model Matrices and uniforms
-		this->updateModelMatrix();
-		this->updateUniforms(shader);
-
-		// Use shader
-		shader->use();
-
-		// Bind Textures to material texture units
-		this->diffuseTexture->bind(this->material->getDiffuseTex());
-		this->specTexture->bind(this->material->getSpecTex());
-		
-		// Bind Vertex Array
-		glBindVertexArray(this->VAO);
-
-		// Draw
-		if (this->nIndices == 0) {
-			glDrawArrays(GL_TRIANGLES, 0, this->nVertices);
-		}
-		if (this->nVertices == 2) {
-			glDrawElements(GL_LINES, this->nIndices, GL_UNSIGNED_INT, 0);
-		}
-		else {
-			glDrawElements(GL_TRIANGLES, this->nIndices, GL_UNSIGNED_INT, 0);
-		}
+		this->transforms->release(this->transform);
 	}
 
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+
 	// Setters and Modifiers
+	// The model matrix is rebuilt by the next TransformStore::update
 	void setPosition(const glm::vec3& position) {
-		this->position = position;
+		if (this->transforms->getPosition(this->transform) != position) {
+			this->transforms->setPosition(this->transform, position);
+		}
 	}
 
 	void setRotation(const glm::vec3& rotation) {
-		this->rotation = rotation;
+		if (this->transforms->getRotation(this->transform) != rotation) {
+			this->transforms->setRotation(this->transform, rotation);
+		}
 	}
 
 	void setScale(const glm::vec3& scale) {
-		this->scale = scale;
+		if (this->transforms->getScale(this->transform) != scale) {
+			this->transforms->setScale(this->transform, scale);
+		}
 	}
 
 	void moveIt(const glm::vec3& moveVector) {
-		this->position += moveVector;
+		this->transforms->setPosition(this->transform, this->transforms->getPosition(this->transform) + moveVector);
 	}
 
 	void rotateIt(const glm::vec3& degree) {
-		this->rotation += degree;
+		this->transforms->setRotation(this->transform, this->transforms->getRotation(this->transform) + degree);
 	}
 
 	void scaleIt(const glm::vec3& scale) {
-		this->scale += scale;
-		if (this->scale.x < 0) {
-			this->scale.x = 0.f;
-		}
-		if (this->scale.y < 0) {
-			this->scale.y = 0.f;
-		}
-		if (this->scale.z < 0) {
-			this->scale.z = 0.f;
-		}
+		this->transforms->setScale(this->transform, glm::max(this->transforms->getScale(this->transform) + scale, glm::vec3(0.f)));
 	}
 
-	void changeTexture(Texture* diffuse, Texture* spec) {
-		this->diffuseTexture = diffuse;
-		this->specTexture = spec;
+	// Materials are owned by MaterialLibrary, switching only changes the per instance index
+	void setMaterial(Material* material) {
+		this->material = material;
 	}
 
 	// Getters
 	unsigned getNindices() {
-		return this->nIndices;
+		return this->geometry->getNindices();
+	}
+
+	const std::shared_ptr<Geometry>& getGeometry() const {
+		return this->geometry;
+	}
+
+	Material* getMaterial() {
+		return this->material;
+	}
+
+	// Model matrix as of the last TransformStore::update
+	const glm::mat4& getModelMatrix() const {
+		return this->transforms->getWorld(this->transform);
+	}
+
+	bool isDirty() const {
+		return this->transforms->isDirty(this->transform);
+	}
+
+	// Exact world space ray test against the geometry triangles
+	// The ray is moved into local space, so the returned parameter is valid for the world ray
+	float intersectRay(const glm::vec3& origin, const glm::vec3& direction, float tMax) const {
+		glm::mat4 inverseModel = glm::inverse(this->getModelMatrix());
+		glm::vec3 localOrigin = glm::vec3(inverseModel * glm::vec4(origin, 1.f));
+		glm::vec3 localDirection = glm::vec3(inverseModel * glm::vec4(direction, 0.f));
+		return this->geometry->intersectRay(localOrigin, localDirection, tMax);
+	}
+
+	// World space box of the geometry as of the last TransformStore::update
+	AABB getWorldBounds() const {
+		return this->geometry->getBounds().transformed(this->getModelMatrix());
 	}
 
 	glm::vec3 getPosition() {
-		return this->position;
+		return this->transforms->getPosition(this->transform);
+	}
+
+	TransformStore::Handle getTransform() const {
+		return this->transform;
 	}
 };
\ No newline at end of file
@@ -0,0 +1,341 @@
+#pragma once
+
+#include<iostream>
+#include<fstream>
+#include<string>
+#include<vector>
+#include<memory>
+#include<cstdint>
+#include<cstring>
+
+#include<sys/types.h>
+#include<sys/stat.h>
+
+#include<glew.h>
+#include<glm.hpp>
+
+#include"MappedFile.h"
+#include"Primitives.h"
+#include"Vertex.h"
+#include"VertexLayout.h"
+#include"MeshOptimizer.h"
+#include"Geometry.h"
+#include"Bounds.h"
+
+// Index range of one level of detail, level 0 is the full mesh
+struct MeshLod {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	// Object space error the level stays within, 0 for the full mesh
+	float error;
+	uint32_t reserved;
+};
+
+// Fixed header at the start of a cooked mesh file, every field little-endian
+// Sections follow at 16 byte aligned offsets : LOD table, vertices in the GPU layout, indices of every LOD
+struct MeshCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+
+	// Size and modification time of the source in nanoseconds, a changed source is cooked again
+	// Windows only reports whole seconds, an edit keeping the size within the same second goes unnoticed there
+	uint64_t sourceSize;
+	int64_t sourceTime;
+
+	uint32_t format;
+	uint32_t stride;
+	uint32_t vertexCount;
+	uint32_t indexType;
+	uint32_t indexCount;
+	uint32_t lodCount;
+
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	uint64_t lodOffset;
+
+	float boundsMin[3];
+	float boundsMax[3];
+	float sphere[4];
+};
+
+static_assert(sizeof(MeshCacheHeader) == 112, "MeshCacheHeader is read straight from mapped files");
+static_assert(sizeof(MeshLod) == 16, "MeshLod is read straight from mapped files");
+
+// Sections of a cooked mesh, in memory after cooking or inside a mapped file
+struct MeshCacheView {
+	MeshCacheHeader header;
+	const unsigned char* vertices;
+	const unsigned char* indices;
+	const MeshLod* lods;
+};
+
+// Cooked mesh owning its sections
+struct CookedMesh {
+	MeshCacheHeader header;
+	std::vector<unsigned char> vertices;
+	std::vector<unsigned char> indices;
+	std::vector<MeshLod> lods;
+
+	MeshCacheView view() const {
+		MeshCacheView view = { this->header, this->vertices.data(), this->indices.data(), this->lods.data() };
+		return view;
+	}
+};
+
+// Converts imported primitives into mesh files already in the GPU vertex and index layout
+// The cooked file sits next to the source (model.obj -> model.obj.mesh); on later imports it is
+// memory mapped and its sections are handed to glBufferStorage as they are
+class MeshCooker {
+public:
+	// Bump when the cooked output changes so old files are rebuilt
+	enum : uint32_t {
+		VERSION = 2,
+		MAGIC = 0x4853454D // "MESH"
+	};
+
+private:
+	static size_t align(size_t offset) {
+		return (offset + 15) & ~static_cast<size_t>(15);
+	}
+
+	// Sections are written and read as they are in memory
+	static bool isLittleEndian() {
+		const uint16_t probe = 1;
+		return *reinterpret_cast<const unsigned char*>(&probe) == 1;
+	}
+
+	static size_t indexBytes(uint32_t indexType) {
+		return indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+	}
+
+public:
+	static std::string cookedPath(const std::string& source) {
+		return source + ".mesh";
+	}
+
+	// Size and modification time in nanoseconds of a file, false if it does not exist
+	// The 64 bit stat keeps sources over 2 GB from failing on Windows
+	static bool sourceStamp(const std::string& source, uint64_t& size, int64_t& time) {
+#ifdef _WIN32
+		struct _stat64 status;
+		if (_stat64(source.c_str(), &status) != 0) {
+			return false;
+		}
+		time = static_cast<int64_t>(status.st_mtime) * 1000000000;
+#else
+		struct stat status;
+		if (stat(source.c_str(), &status) != 0) {
+			return false;
+		}
+#ifdef __APPLE__
+		time = static_cast<int64_t>(status.st_mtimespec.tv_sec) * 1000000000 + status.st_mtimespec.tv_nsec;
+#else
+		time = static_cast<int64_t>(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+#endif
+#endif
+		size = static_cast<uint64_t>(status.st_size);
+		return true;
+	}
+
+	// Encode an optimized primitive into format, indices are 16 bit whenever the vertex count allows
+	// The LOD table holds the full mesh only until a simplifier fills in coarser levels
+	static void cook(Primitive* primitive, VertexFormat format, CookedMesh& mesh) {
+		VertexLayout layout(format);
+		unsigned nVertices = primitive->getNvertices();
+		unsigned nIndices = primitive->getNindices();
+		layout.encode(primitive->getVertices(), nVertices, mesh.vertices);
+
+		uint32_t indexType = nVertices <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		mesh.indices.resize(nIndices * indexBytes(indexType));
+		if (indexType == GL_UNSIGNED_SHORT) {
+			std::vector<GLushort> shortIndices(primitive->getIndices(), primitive->getIndices() + nIndices);
+			std::memcpy(mesh.indices.data(), shortIndices.data(), mesh.indices.size());
+		}
+		else {
+			std::memcpy(mesh.indices.data(), primitive->getIndices(), mesh.indices.size());
+		}
+
+		MeshLod lod = { 0, nIndices, 0.f, 0 };
+		mesh.lods.assign(1, lod);
+
+		MeshCacheHeader& header = mesh.header;
+		std::memset(&header, 0, sizeof(header));
+		header.magic = MAGIC;
+		header.version = VERSION;
+		header.format = format;
+		header.stride = layout.getStride();
+		header.vertexCount = nVertices;
+		header.indexType = indexType;
+		header.indexCount = nIndices;
+		header.lodCount = static_cast<uint32_t>(mesh.lods.size());
+		header.lodOffset = align(sizeof(MeshCacheHeader));
+		header.vertexOffset = align(header.lodOffset + mesh.lods.size() * sizeof(MeshLod));
+		header.indexOffset = align(header.vertexOffset + mesh.vertices.size());
+
+		const AABB& bounds = primitive->getBounds();
+		const BoundingSphere& sphere = primitive->getSphere();
+		for (int i = 0; i < 3; i++) {
+			header.boundsMin[i] = bounds.min[i];
+			header.boundsMax[i] = bounds.max[i];
+			header.sphere[i] = sphere.center[i];
+		}
+		header.sphere[3] = sphere.radius;
+	}
+
+	static bool save(const std::string& path, const CookedMesh& mesh) {
+		if (!isLittleEndian()) {
+			return false;
+		}
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			std::cout << "ERROR : MeshCooker::save - Could not write " << path << std::endl;
+			return false;
+		}
+		const MeshCacheHeader& header = mesh.header;
+		const char padding[16] = { 0 };
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(padding, header.lodOffset - sizeof(header));
+		file.write(reinterpret_cast<const char*>(mesh.lods.data()), mesh.lods.size() * sizeof(MeshLod));
+		file.write(padding, header.vertexOffset - header.lodOffset - mesh.lods.size() * sizeof(MeshLod));
+		file.write(reinterpret_cast<const char*>(mesh.vertices.data()), mesh.vertices.size());
+		file.write(padding, header.indexOffset - header.vertexOffset - mesh.vertices.size());
+		file.write(reinterpret_cast<const char*>(mesh.indices.data()), mesh.indices.size());
+		return file.good();
+	}
+
+	// Locate the sections of a cooked file, fails if it is foreign, outdated, truncated, empty,
+	// cooked from another source or for another vertex format
+	static bool read(const unsigned char* bytes, size_t size, VertexFormat format, uint64_t sourceSize, int64_t sourceTime, MeshCacheView& view) {
+		if (!isLittleEndian() || size < sizeof(MeshCacheHeader)) {
+			return false;
+		}
+		MeshCacheHeader& header = view.header;
+		std::memcpy(&header, bytes, sizeof(header));
+		if (header.magic != MAGIC || header.version != VERSION || header.sourceSize != sourceSize || header.sourceTime != sourceTime
+			|| header.format != static_cast<uint32_t>(format) || header.stride != VertexLayout(format).getStride()
+			|| (header.indexType != GL_UNSIGNED_SHORT && header.indexType != GL_UNSIGNED_INT) || header.lodCount == 0
+			|| header.vertexCount == 0 || header.indexCount == 0) {
+			return false;
+		}
+		uint64_t vertexSize = static_cast<uint64_t>(header.vertexCount) * header.stride;
+		uint64_t indexSize = static_cast<uint64_t>(header.indexCount) * indexBytes(header.indexType);
+		uint64_t lodSize = static_cast<uint64_t>(header.lodCount) * sizeof(MeshLod);
+		// Written as offset, then length within the rest, so corrupt values can not wrap around
+		uint64_t fileSize = size;
+		if (header.lodOffset % 16 || header.vertexOffset % 16 || header.indexOffset % 16
+			|| header.lodOffset > fileSize || lodSize > fileSize - header.lodOffset
+			|| header.vertexOffset > fileSize || vertexSize > fileSize - header.vertexOffset
+			|| header.indexOffset > fileSize || indexSize > fileSize - header.indexOffset) {
+			return false;
+		}
+		view.vertices = bytes + header.vertexOffset;
+		view.indices = bytes + header.indexOffset;
+		view.lods = reinterpret_cast<const MeshLod*>(bytes + header.lodOffset);
+		for (uint32_t i = 0; i < header.lodCount; i++) {
+			if (static_cast<uint64_t>(view.lods[i].firstIndex) + view.lods[i].indexCount > header.indexCount) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// CPU copies for ray tests, positions are the leading float3 of every vertex format
+	// False if an index of the full mesh is out of range
+	static bool readPositions(const MeshCacheView& view, std::vector<glm::vec3>& positions, std::vector<GLuint>& indices) {
+		const MeshCacheHeader& header = view.header;
+		positions.resize(header.vertexCount);
+		for (uint32_t i = 0; i < header.vertexCount; i++) {
+			std::memcpy(&positions[i], view.vertices + static_cast<size_t>(i) * header.stride, sizeof(glm::vec3));
+		}
+
+		const MeshLod& lod = view.lods[0];
+		indices.resize(lod.indexCount);
+		GLuint outOfRange = 0;
+		if (header.indexType == GL_UNSIGNED_SHORT) {
+			const unsigned char* source = view.indices + static_cast<size_t>(lod.firstIndex) * 2;
+			for (uint32_t i = 0; i < lod.indexCount; i++) {
+				GLushort index;
+				std::memcpy(&index, source + i * 2, 2);
+				indices[i] = index;
+				outOfRange |= index >= header.vertexCount;
+			}
+		}
+		else {
+			std::memcpy(indices.data(), view.indices + static_cast<size_t>(lod.firstIndex) * 4, static_cast<size_t>(lod.indexCount) * 4);
+			for (uint32_t i = 0; i < lod.indexCount; i++) {
+				outOfRange |= indices[i] >= header.vertexCount;
+			}
+		}
+		return outOfRange == 0;
+	}
+
+	// GPU streams drawing LOD 0, vertices and indices go from view to the driver without conversion
+	static bool toStreams(const MeshCacheView& view, GeometryStreams& streams) {
+		streams = GeometryStreams();
+		if (!readPositions(view, streams.positions, streams.indices)) {
+			return false;
+		}
+		const MeshCacheHeader& header = view.header;
+		VertexFormat format = static_cast<VertexFormat>(header.format);
+		std::shared_ptr<GeometryBuffer> vertexBuffer = std::make_shared<GeometryBuffer>(view.vertices,
+			static_cast<GLsizeiptr>(header.vertexCount) * header.stride);
+		const std::vector<VertexAttribute>& attributes = VertexLayout(format).getAttributes();
+		for (size_t i = 0; i < attributes.size(); i++) {
+			GeometryAttribute attribute = { attributes[i].location, attributes[i].size, attributes[i].type, attributes[i].normalized,
+				vertexBuffer, static_cast<GLintptr>(attributes[i].offset), static_cast<GLsizei>(header.stride) };
+			streams.attributes.push_back(attribute);
+		}
+
+		streams.indexBuffer = std::make_shared<GeometryBuffer>(view.indices,
+			static_cast<GLsizeiptr>(header.indexCount * indexBytes(header.indexType)));
+		streams.indexType = header.indexType;
+		streams.indexOffset = static_cast<GLintptr>(view.lods[0].firstIndex * indexBytes(header.indexType));
+		streams.nIndices = view.lods[0].indexCount;
+
+		// Two vertex primitives are lines, as in Geometry
+		streams.mode = header.vertexCount == 2 ? GL_LINES : GL_TRIANGLES;
+		streams.nVertices = header.vertexCount;
+		streams.format = format;
+		streams.bounds = AABB(glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]),
+			glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]));
+		streams.sphere = BoundingSphere(glm::vec3(header.sphere[0], header.sphere[1], header.sphere[2]), header.sphere[3]);
+		return true;
+	}
+
+	// Streams for the model at source, mapped from its cooked file or imported as T(source),
+	// optimized, cooked and saved for the next time
+	template<typename T>
+	static bool loadOrImport(const std::string& source, VertexFormat format, GeometryStreams& streams) {
+		uint64_t sourceSize;
+		int64_t sourceTime;
+		if (!sourceStamp(source, sourceSize, sourceTime)) {
+			std::cout << "ERROR : MeshCooker::loadOrImport - Can not open " << source << std::endl;
+			return false;
+		}
+		std::string path = cookedPath(source);
+		{
+			MappedFile cooked(path);
+			MeshCacheView view;
+			if (cooked.isOpen() && read(cooked.getData(), cooked.getSize(), format, sourceSize, sourceTime, view) && toStreams(view, streams)) {
+				return true;
+			}
+		}
+
+		T model(source);
+		if (!model.isLoaded()) {
+			return false;
+		}
+		// Nothing to draw, and GL refuses empty buffers
+		if (model.getNvertices() == 0 || model.getNindices() == 0) {
+			std::cout << "ERROR : MeshCooker::loadOrImport - No faces in " << source << std::endl;
+			return false;
+		}
+		MeshOptimizer::optimize(&model);
+		CookedMesh mesh;
+		cook(&model, format, mesh);
+		mesh.header.sourceSize = sourceSize;
+		mesh.header.sourceTime = sourceTime;
+		save(path, mesh);
+		return toStreams(mesh.view(), streams);
+	}
+};
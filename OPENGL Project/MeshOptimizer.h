@@ -0,0 +1,288 @@
+#pragma once
+
+#include<vector>
+#include<algorithm>
+#include<cstring>
+
+#include<glew.h>
+#include<glm.hpp>
+
+#include"Vertex.h"
+#include"Primitives.h"
+
+// Average cache miss ratio of a triangle list before and after optimization
+struct MeshOptimizerStats {
+	float acmrBefore;
+	float acmrAfter;
+};
+
+// Import time reordering of indexed triangle lists
+// Triangles are reordered for the post-transform vertex cache (Tipsify, Sander et al. 2007),
+// optionally clusters of them are sorted so outward facing parts draw first to cut overdraw,
+// and vertices are renumbered in first use order for fetch locality
+class MeshOptimizer {
+public:
+	// FIFO post-transform cache size assumed by the simulation and the reordering
+	static const unsigned CACHE_SIZE = 16;
+
+private:
+	// Triangles using each vertex, flattened
+	struct Adjacency {
+		std::vector<unsigned> offsets;
+		std::vector<unsigned> counts;
+		std::vector<unsigned> triangles;
+
+		Adjacency(const GLuint* indices, size_t indexCount, size_t vertexCount) {
+			this->offsets.assign(vertexCount, 0);
+			this->counts.assign(vertexCount, 0);
+			for (size_t i = 0; i < indexCount; i++) {
+				this->counts[indices[i]]++;
+			}
+			unsigned offset = 0;
+			for (size_t v = 0; v < vertexCount; v++) {
+				this->offsets[v] = offset;
+				offset += this->counts[v];
+			}
+			this->triangles.resize(indexCount);
+			std::vector<unsigned> fill(this->offsets);
+			for (size_t i = 0; i < indexCount; i++) {
+				this->triangles[fill[indices[i]]++] = static_cast<unsigned>(i / 3);
+			}
+		}
+	};
+
+	// Next fanning vertex, the candidate staying in cache longest while still having triangles
+	static int nextVertex(const std::vector<GLuint>& candidates, const std::vector<unsigned>& live,
+		const std::vector<unsigned>& cacheTime, unsigned timestamp, std::vector<GLuint>& deadEnd, size_t& cursor) {
+		int best = -1;
+		int bestPriority = -1;
+		for (size_t i = 0; i < candidates.size(); i++) {
+			GLuint vertex = candidates[i];
+			if (live[vertex] == 0) {
+				continue;
+			}
+			// Still in cache after emitting its remaining triangles
+			int priority = 0;
+			if (timestamp - cacheTime[vertex] + 2 * live[vertex] <= CACHE_SIZE) {
+				priority = static_cast<int>(timestamp - cacheTime[vertex]);
+			}
+			if (priority > bestPriority) {
+				bestPriority = priority;
+				best = static_cast<int>(vertex);
+			}
+		}
+		if (best >= 0) {
+			return best;
+		}
+
+		// Dead end, recently used vertices first, then the next vertex in input order
+		while (!deadEnd.empty()) {
+			GLuint vertex = deadEnd.back();
+			deadEnd.pop_back();
+			if (live[vertex] > 0) {
+				return static_cast<int>(vertex);
+			}
+		}
+		while (cursor < live.size()) {
+			if (live[cursor] > 0) {
+				return static_cast<int>(cursor++);
+			}
+			cursor++;
+		}
+		return -1;
+	}
+
+	// Cache misses of triangle in a FIFO cache, the cache is updated
+	static unsigned touch(const GLuint* triangle, std::vector<unsigned>& cacheTime, unsigned& timestamp) {
+		unsigned misses = 0;
+		for (int corner = 0; corner < 3; corner++) {
+			GLuint vertex = triangle[corner];
+			if (timestamp - cacheTime[vertex] > CACHE_SIZE) {
+				cacheTime[vertex] = timestamp++;
+				misses++;
+			}
+		}
+		return misses;
+	}
+
+public:
+	// Vertices transformed per triangle with a FIFO cache of CACHE_SIZE, 3 is worst, about 0.5 is ideal for grids
+	static float acmr(const GLuint* indices, size_t indexCount, size_t vertexCount) {
+		if (indexCount < 3) {
+			return 0.f;
+		}
+		std::vector<unsigned> cacheTime(vertexCount, 0);
+		unsigned timestamp = CACHE_SIZE + 1;
+		size_t misses = 0;
+		for (size_t i = 0; i + 2 < indexCount; i += 3) {
+			misses += touch(indices + i, cacheTime, timestamp);
+		}
+		return static_cast<float>(misses) / (indexCount / 3);
+	}
+
+	// Reorder triangles for the post-transform cache, linear in the triangle count
+	static void optimizeVertexCache(std::vector<GLuint>& indices, size_t vertexCount) {
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0) {
+			return;
+		}
+		Adjacency adjacency(indices.data(), triangleCount * 3, vertexCount);
+		std::vector<unsigned> live(adjacency.counts);
+		std::vector<unsigned> cacheTime(vertexCount, 0);
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<GLuint> deadEnd;
+		std::vector<GLuint> candidates;
+		std::vector<GLuint> output;
+		output.reserve(triangleCount * 3);
+
+		unsigned timestamp = CACHE_SIZE + 1;
+		size_t cursor = 0;
+		int fanning = nextVertex(candidates, live, cacheTime, timestamp, deadEnd, cursor);
+
+		while (fanning >= 0) {
+			candidates.clear();
+			unsigned first = adjacency.offsets[fanning];
+			for (unsigned i = first; i < first + adjacency.counts[fanning]; i++) {
+				unsigned triangle = adjacency.triangles[i];
+				if (emitted[triangle]) {
+					continue;
+				}
+				for (int corner = 0; corner < 3; corner++) {
+					GLuint vertex = indices[triangle * 3 + corner];
+					output.push_back(vertex);
+					deadEnd.push_back(vertex);
+					candidates.push_back(vertex);
+					live[vertex]--;
+					if (timestamp - cacheTime[vertex] > CACHE_SIZE) {
+						cacheTime[vertex] = timestamp++;
+					}
+				}
+				emitted[triangle] = true;
+			}
+			fanning = nextVertex(candidates, live, cacheTime, timestamp, deadEnd, cursor);
+		}
+
+		// Degenerate leftovers of a partial last triangle are kept as they were
+		output.insert(output.end(), indices.begin() + triangleCount * 3, indices.end());
+		indices.swap(output);
+	}
+
+	// Sort clusters of cache optimized triangles so outward facing ones draw first
+	// Clusters are cut only where the cache restarting costs at most threshold times the mesh ACMR
+	static void optimizeOverdraw(std::vector<GLuint>& indices, const Vertex* vertices, size_t vertexCount, float threshold = 1.05f) {
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0) {
+			return;
+		}
+		float meshAcmr = acmr(indices.data(), triangleCount * 3, vertexCount);
+
+		// Cluster boundaries as triangle offsets
+		std::vector<size_t> clusters;
+		std::vector<unsigned> cacheTime(vertexCount, 0);
+		unsigned timestamp = CACHE_SIZE + 1;
+		size_t clusterMisses = 0;
+		size_t clusterStart = 0;
+		clusters.push_back(0);
+		for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+			clusterMisses += touch(indices.data() + triangle * 3, cacheTime, timestamp);
+			size_t clusterSize = triangle + 1 - clusterStart;
+			if (clusterSize >= CACHE_SIZE && clusterMisses <= threshold * meshAcmr * clusterSize && triangle + 1 < triangleCount) {
+				clusters.push_back(triangle + 1);
+				clusterStart = triangle + 1;
+				clusterMisses = 0;
+				// The next cluster may be drawn after any other, start it cold
+				timestamp += CACHE_SIZE + 1;
+			}
+		}
+		clusters.push_back(triangleCount);
+
+		// Area weighted centroid of the whole mesh
+		glm::vec3 meshCentroid(0.f);
+		float meshArea = 0.f;
+		for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+			const glm::vec3& a = vertices[indices[triangle * 3]].position;
+			const glm::vec3& b = vertices[indices[triangle * 3 + 1]].position;
+			const glm::vec3& c = vertices[indices[triangle * 3 + 2]].position;
+			float area = glm::length(glm::cross(b - a, c - a));
+			meshCentroid += (a + b + c) * (area / 3.f);
+			meshArea += area;
+		}
+		meshCentroid = meshArea > 0.f ? meshCentroid / meshArea : glm::vec3(0.f);
+
+		// Occlusion potential, how far out the cluster faces from the mesh center
+		std::vector<std::pair<float, size_t> > order(clusters.size() - 1);
+		for (size_t cluster = 0; cluster + 1 < clusters.size(); cluster++) {
+			glm::vec3 centroid(0.f);
+			glm::vec3 normal(0.f);
+			float area = 0.f;
+			for (size_t triangle = clusters[cluster]; triangle < clusters[cluster + 1]; triangle++) {
+				const glm::vec3& a = vertices[indices[triangle * 3]].position;
+				const glm::vec3& b = vertices[indices[triangle * 3 + 1]].position;
+				const glm::vec3& c = vertices[indices[triangle * 3 + 2]].position;
+				glm::vec3 cross = glm::cross(b - a, c - a);
+				float triangleArea = glm::length(cross);
+				centroid += (a + b + c) * (triangleArea / 3.f);
+				normal += cross;
+				area += triangleArea;
+			}
+			centroid = area > 0.f ? centroid / area : centroid;
+			float length = glm::length(normal);
+			float potential = length > 0.f ? glm::dot(centroid - meshCentroid, normal / length) : 0.f;
+			order[cluster] = std::make_pair(-potential, cluster);
+		}
+		std::stable_sort(order.begin(), order.end());
+
+		std::vector<GLuint> output;
+		output.reserve(indices.size());
+		for (size_t i = 0; i < order.size(); i++) {
+			size_t cluster = order[i].second;
+			output.insert(output.end(), indices.begin() + clusters[cluster] * 3, indices.begin() + clusters[cluster + 1] * 3);
+		}
+		output.insert(output.end(), indices.begin() + triangleCount * 3, indices.end());
+		indices.swap(output);
+	}
+
+	// Renumber vertices in the order the indices first use them, unused vertices are dropped
+	static void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<GLuint>& indices) {
+		const GLuint unused = 0xFFFFFFFFu;
+		std::vector<GLuint> remap(vertices.size(), unused);
+		std::vector<Vertex> output;
+		output.reserve(vertices.size());
+		for (size_t i = 0; i < indices.size(); i++) {
+			GLuint& index = remap[indices[i]];
+			if (index == unused) {
+				index = static_cast<GLuint>(output.size());
+				output.push_back(vertices[indices[i]]);
+			}
+			indices[i] = index;
+		}
+		vertices.swap(output);
+	}
+
+	// Every pass on an indexed triangle list, overdraw sorting is optional since it costs some cache hits
+	static MeshOptimizerStats optimize(std::vector<Vertex>& vertices, std::vector<GLuint>& indices, bool overdraw = false) {
+		MeshOptimizerStats stats;
+		stats.acmrBefore = acmr(indices.data(), indices.size(), vertices.size());
+		optimizeVertexCache(indices, vertices.size());
+		if (overdraw) {
+			optimizeOverdraw(indices, vertices.data(), vertices.size());
+		}
+		optimizeVertexFetch(vertices, indices);
+		stats.acmrAfter = acmr(indices.data(), indices.size(), vertices.size());
+		return stats;
+	}
+
+	// Optimize primitive in place, lines and unindexed primitives are left alone
+	static MeshOptimizerStats optimize(Primitive* primitive, bool overdraw = false) {
+		std::vector<Vertex> vertices(primitive->getVertices(), primitive->getVertices() + primitive->getNvertices());
+		std::vector<GLuint> indices(primitive->getIndices(), primitive->getIndices() + primitive->getNindices());
+		if (vertices.size() < 3 || indices.size() < 3 || indices.size() % 3 != 0) {
+			MeshOptimizerStats stats;
+			stats.acmrBefore = stats.acmrAfter = acmr(indices.data(), indices.size(), vertices.size());
+			return stats;
+		}
+		MeshOptimizerStats stats = optimize(vertices, indices, overdraw);
+		primitive->set(vertices.data(), static_cast<unsigned>(vertices.size()), indices.data(), static_cast<unsigned>(indices.size()));
+		return stats;
+	}
+};
@@ -0,0 +1,489 @@
+#pragma once
+
+#include<iostream>
+#include<string>
+#include<vector>
+#include<memory>
+#include<algorithm>
+#include<cstring>
+#include<cmath>
+#include<climits>
+#include<cstdint>
+
+#include<glew.h>
+#include<glm.hpp>
+
+#include"Vertex.h"
+#include"Primitives.h"
+#include"MappedFile.h"
+#include"ThreadPool.h"
+
+// Wavefront OBJ triangle mesh
+// The file is memory mapped and split into line aligned chunks parsed in parallel, then the
+// position/texcoord/normal triples of the faces are welded into shared Vertex entries.
+// Supports v (with optional rgb), vt, vn and f with polygons, negative and partial indices.
+// Missing normals are rebuilt from the faces, everything else (groups, materials) is skipped
+class ObjModel : public Primitive {
+private:
+	// Marks an attribute the face corner does not reference
+	static const int32_t MISSING = INT32_MIN;
+
+	// Chunks are at least this large, smaller files are parsed on one thread
+	static const size_t MIN_CHUNK = 1 << 20;
+
+	// Face corner, 0 based indices before and after resolving
+	struct Corner {
+		int32_t position;
+		int32_t texcoord;
+		int32_t normal;
+	};
+
+	// Everything one chunk declares, indices of relative corners are still chunk local
+	struct Chunk {
+		const char* begin;
+		const char* end;
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> colors;
+		std::vector<glm::vec2> texcoords;
+		std::vector<glm::vec3> normals;
+		std::vector<Corner> corners;
+		std::vector<unsigned char> relative;
+		size_t positionBase, texcoordBase, normalBase;
+	};
+
+	bool loaded;
+
+	static bool isSpace(char c) {
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	static void skipSpaces(const char*& p, const char* end) {
+		while (p < end && isSpace(*p)) {
+			p++;
+		}
+	}
+
+	// Decimal float with optional sign, fraction and exponent, no locale and no allocation
+	static bool parseFloat(const char*& p, const char* end, float& value) {
+		static const double powers[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+		skipSpaces(p, end);
+		const char* start = p;
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) {
+			negative = *p == '-';
+			p++;
+		}
+
+		uint64_t mantissa = 0;
+		int exponent = 0;
+		int digits = 0;
+		bool sawDigit = false;
+		while (p < end && *p >= '0' && *p <= '9') {
+			sawDigit = true;
+			// Digits beyond what fits only scale the value
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += mantissa > 0;
+			}
+			else {
+				exponent++;
+			}
+			p++;
+		}
+		if (p < end && *p == '.') {
+			p++;
+			while (p < end && *p >= '0' && *p <= '9') {
+				sawDigit = true;
+				if (digits < 19) {
+					mantissa = mantissa * 10 + (*p - '0');
+					digits += mantissa > 0;
+					exponent--;
+				}
+				p++;
+			}
+		}
+		if (!sawDigit) {
+			p = start;
+			return false;
+		}
+		if (p < end && (*p == 'e' || *p == 'E')) {
+			const char* exponentStart = p++;
+			bool negativeExponent = false;
+			if (p < end && (*p == '-' || *p == '+')) {
+				negativeExponent = *p == '-';
+				p++;
+			}
+			if (p < end && *p >= '0' && *p <= '9') {
+				int written = 0;
+				while (p < end && *p >= '0' && *p <= '9') {
+					written = written < 10000 ? written * 10 + (*p - '0') : written;
+					p++;
+				}
+				exponent += negativeExponent ? -written : written;
+			}
+			else {
+				p = exponentStart;
+			}
+		}
+
+		double result = static_cast<double>(mantissa);
+		if (exponent < 0) {
+			result = -exponent <= 22 ? result / powers[-exponent] : result * std::pow(10.0, exponent);
+		}
+		else if (exponent > 0) {
+			result = exponent <= 22 ? result * powers[exponent] : result * std::pow(10.0, exponent);
+		}
+		value = static_cast<float>(negative ? -result : result);
+		return true;
+	}
+
+	static bool parseInt(const char*& p, const char* end, int32_t& value) {
+		bool negative = false;
+		if (p < end && *p == '-') {
+			negative = true;
+			p++;
+		}
+		if (p >= end || *p < '0' || *p > '9') {
+			return false;
+		}
+		int64_t result = 0;
+		while (p < end && *p >= '0' && *p <= '9') {
+			result = result < INT32_MAX ? result * 10 + (*p - '0') : result;
+			p++;
+		}
+		value = static_cast<int32_t>(negative ? -std::min<int64_t>(result, INT32_MAX) : std::min<int64_t>(result, INT32_MAX));
+		return true;
+	}
+
+	// One index of a face corner, 1 based or negative from the end of what is declared so far
+	// Stored 0 based, relative ones as chunk local with their bit set in relative
+	static int32_t faceIndex(int32_t index, size_t declared, unsigned char bit, unsigned char& relative) {
+		if (index > 0) {
+			return index - 1;
+		}
+		if (index < 0) {
+			relative |= bit;
+			return static_cast<int32_t>(declared) + index;
+		}
+		return MISSING;
+	}
+
+	// Parses the lines of chunk, faces are fan triangulated
+	static void parseChunk(Chunk& chunk) {
+		std::vector<Corner> polygon;
+		std::vector<unsigned char> polygonRelative;
+		const char* p = chunk.begin;
+		const char* end = chunk.end;
+		while (p < end) {
+			const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+			if (!lineEnd) {
+				lineEnd = end;
+			}
+			skipSpaces(p, lineEnd);
+
+			if (lineEnd - p > 2 && p[0] == 'v' && isSpace(p[1])) {
+				p++;
+				glm::vec3 position(0.f);
+				parseFloat(p, lineEnd, position.x);
+				parseFloat(p, lineEnd, position.y);
+				parseFloat(p, lineEnd, position.z);
+				chunk.positions.push_back(position);
+
+				// Vertex colors extension, white where absent
+				glm::vec3 color(1.f);
+				if (parseFloat(p, lineEnd, color.r)) {
+					parseFloat(p, lineEnd, color.g);
+					parseFloat(p, lineEnd, color.b);
+					chunk.colors.resize(chunk.positions.size() - 1, glm::vec3(1.f));
+					chunk.colors.push_back(color);
+				}
+			}
+			else if (lineEnd - p > 3 && p[0] == 'v' && p[1] == 't' && isSpace(p[2])) {
+				p += 2;
+				glm::vec2 texcoord(0.f);
+				parseFloat(p, lineEnd, texcoord.x);
+				parseFloat(p, lineEnd, texcoord.y);
+				chunk.texcoords.push_back(texcoord);
+			}
+			else if (lineEnd - p > 3 && p[0] == 'v' && p[1] == 'n' && isSpace(p[2])) {
+				p += 2;
+				glm::vec3 normal(0.f);
+				parseFloat(p, lineEnd, normal.x);
+				parseFloat(p, lineEnd, normal.y);
+				parseFloat(p, lineEnd, normal.z);
+				chunk.normals.push_back(normal);
+			}
+			else if (lineEnd - p > 2 && p[0] == 'f' && isSpace(p[1])) {
+				p++;
+				polygon.clear();
+				polygonRelative.clear();
+				for (;;) {
+					skipSpaces(p, lineEnd);
+					int32_t index = 0;
+					if (!parseInt(p, lineEnd, index)) {
+						break;
+					}
+					unsigned char relative = 0;
+					Corner corner;
+					corner.position = faceIndex(index, chunk.positions.size(), 1, relative);
+					corner.texcoord = MISSING;
+					corner.normal = MISSING;
+					if (p < lineEnd && *p == '/') {
+						p++;
+						if (parseInt(p, lineEnd, index)) {
+							corner.texcoord = faceIndex(index, chunk.texcoords.size(), 2, relative);
+						}
+						if (p < lineEnd && *p == '/') {
+							p++;
+							if (parseInt(p, lineEnd, index)) {
+								corner.normal = faceIndex(index, chunk.normals.size(), 4, relative);
+							}
+						}
+					}
+					// Skip whatever else the token holds
+					while (p < lineEnd && !isSpace(*p)) {
+						p++;
+					}
+					polygon.push_back(corner);
+					polygonRelative.push_back(relative);
+				}
+				for (size_t i = 2; i < polygon.size(); i++) {
+					size_t fan[3] = { 0, i - 1, i };
+					for (int k = 0; k < 3; k++) {
+						chunk.corners.push_back(polygon[fan[k]]);
+						chunk.relative.push_back(polygonRelative[fan[k]]);
+					}
+				}
+			}
+			p = lineEnd + 1;
+		}
+		if (!chunk.colors.empty()) {
+			chunk.colors.resize(chunk.positions.size(), glm::vec3(1.f));
+		}
+	}
+
+	// Global 0 based index, MISSING if out of range
+	static int32_t resolve(int32_t index, bool relative, size_t base, size_t count) {
+		if (index == MISSING) {
+			return MISSING;
+		}
+		int64_t global = relative ? static_cast<int64_t>(base) + index : index;
+		return global >= 0 && global < static_cast<int64_t>(count) ? static_cast<int32_t>(global) : MISSING;
+	}
+
+	static uint32_t hashCorner(const Corner& corner) {
+		uint32_t hash = static_cast<uint32_t>(corner.position) * 0x9E3779B1u;
+		hash ^= static_cast<uint32_t>(corner.texcoord) * 0x85EBCA77u + (hash << 6) + (hash >> 2);
+		hash ^= static_cast<uint32_t>(corner.normal) * 0xC2B2AE3Du + (hash << 6) + (hash >> 2);
+		return hash ^ (hash >> 15);
+	}
+
+	static bool sameCorner(const Corner& a, const Corner& b) {
+		return a.position == b.position && a.texcoord == b.texcoord && a.normal == b.normal;
+	}
+
+	void load(const std::string& fileName, ThreadPool* pool) {
+		MappedFile file(fileName);
+		if (!file.isOpen()) {
+			std::cout << "ERROR : ObjModel::load - Can not open " << fileName << std::endl;
+			return;
+		}
+		const char* data = reinterpret_cast<const char*>(file.getData());
+		size_t size = file.getSize();
+
+		// Line aligned chunks, a few per thread so uneven ones balance out
+		ThreadPool* workers = pool;
+		std::unique_ptr<ThreadPool> ownPool;
+		if (!workers) {
+			ownPool.reset(new ThreadPool(size < 2 * MIN_CHUNK ? 1 : 0));
+			workers = ownPool.get();
+		}
+		size_t chunkCount = std::max<size_t>(1, std::min<size_t>(size / MIN_CHUNK, workers->getThreadCount() * 4));
+		std::vector<Chunk> chunks(chunkCount);
+		const char* previous = data;
+		for (size_t i = 0; i < chunkCount; i++) {
+			const char* split = i + 1 == chunkCount ? data + size : std::max(previous, data + size * (i + 1) / chunkCount);
+			const char* newline = split < data + size ? static_cast<const char*>(std::memchr(split, '\n', data + size - split)) : nullptr;
+			const char* chunkEnd = i + 1 == chunkCount || !newline ? data + size : newline + 1;
+			chunks[i].begin = previous;
+			chunks[i].end = chunkEnd;
+			previous = chunkEnd;
+		}
+
+		workers->parallelFor(chunkCount, [&chunks](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				parseChunk(chunks[i]);
+			}
+		});
+
+		// Offsets of every chunk in the global attribute arrays
+		size_t positionCount = 0, texcoordCount = 0, normalCount = 0;
+		bool hasColors = false;
+		for (size_t i = 0; i < chunkCount; i++) {
+			chunks[i].positionBase = positionCount;
+			chunks[i].texcoordBase = texcoordCount;
+			chunks[i].normalBase = normalCount;
+			positionCount += chunks[i].positions.size();
+			texcoordCount += chunks[i].texcoords.size();
+			normalCount += chunks[i].normals.size();
+			hasColors = hasColors || !chunks[i].colors.empty();
+		}
+		if (positionCount == 0) {
+			std::cout << "ERROR : ObjModel::load - No vertices in " << fileName << std::endl;
+			return;
+		}
+
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> colors;
+		std::vector<glm::vec2> texcoords;
+		std::vector<glm::vec3> normals;
+		positions.reserve(positionCount);
+		texcoords.reserve(texcoordCount);
+		normals.reserve(normalCount);
+		if (hasColors) {
+			colors.reserve(positionCount);
+		}
+		for (size_t i = 0; i < chunkCount; i++) {
+			positions.insert(positions.end(), chunks[i].positions.begin(), chunks[i].positions.end());
+			texcoords.insert(texcoords.end(), chunks[i].texcoords.begin(), chunks[i].texcoords.end());
+			normals.insert(normals.end(), chunks[i].normals.begin(), chunks[i].normals.end());
+			if (hasColors) {
+				if (chunks[i].colors.empty()) {
+					colors.insert(colors.end(), chunks[i].positions.size(), glm::vec3(1.f));
+				}
+				else {
+					colors.insert(colors.end(), chunks[i].colors.begin(), chunks[i].colors.end());
+				}
+			}
+			std::vector<glm::vec3>().swap(chunks[i].positions);
+			std::vector<glm::vec3>().swap(chunks[i].colors);
+			std::vector<glm::vec2>().swap(chunks[i].texcoords);
+			std::vector<glm::vec3>().swap(chunks[i].normals);
+		}
+
+		// Global indices, triangles without a valid position are dropped later
+		workers->parallelFor(chunkCount, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				Chunk& chunk = chunks[i];
+				for (size_t c = 0; c < chunk.corners.size(); c++) {
+					Corner& corner = chunk.corners[c];
+					unsigned char relative = chunk.relative[c];
+					corner.position = resolve(corner.position, (relative & 1) != 0, chunk.positionBase, positionCount);
+					corner.texcoord = resolve(corner.texcoord, (relative & 2) != 0, chunk.texcoordBase, texcoordCount);
+					corner.normal = resolve(corner.normal, (relative & 4) != 0, chunk.normalBase, normalCount);
+				}
+				std::vector<unsigned char>().swap(chunk.relative);
+			}
+		});
+
+		// Weld identical corners, open addressing over indices into unique
+		std::vector<Corner> unique;
+		std::vector<GLuint> indices;
+		std::vector<uint32_t> table(1024, UINT32_MAX);
+		size_t mask = table.size() - 1;
+		size_t dropped = 0;
+		for (size_t i = 0; i < chunkCount; i++) {
+			const std::vector<Corner>& corners = chunks[i].corners;
+			indices.reserve(indices.size() + corners.size());
+			for (size_t c = 0; c + 2 < corners.size(); c += 3) {
+				if (corners[c].position == MISSING || corners[c + 1].position == MISSING || corners[c + 2].position == MISSING) {
+					dropped++;
+					continue;
+				}
+				for (int k = 0; k < 3; k++) {
+					const Corner& corner = corners[c + k];
+					size_t slot = hashCorner(corner) & mask;
+					while (table[slot] != UINT32_MAX && !sameCorner(unique[table[slot]], corner)) {
+						slot = (slot + 1) & mask;
+					}
+					if (table[slot] == UINT32_MAX) {
+						table[slot] = static_cast<uint32_t>(unique.size());
+						unique.push_back(corner);
+
+						// Keep the load under one half
+						if (unique.size() * 2 > table.size()) {
+							std::vector<uint32_t> grown(table.size() * 2, UINT32_MAX);
+							size_t grownMask = grown.size() - 1;
+							for (size_t u = 0; u < unique.size(); u++) {
+								size_t target = hashCorner(unique[u]) & grownMask;
+								while (grown[target] != UINT32_MAX) {
+									target = (target + 1) & grownMask;
+								}
+								grown[target] = static_cast<uint32_t>(u);
+							}
+							table.swap(grown);
+							mask = grownMask;
+						}
+						indices.push_back(static_cast<GLuint>(unique.size() - 1));
+					}
+					else {
+						indices.push_back(table[slot]);
+					}
+				}
+			}
+			std::vector<Corner>().swap(chunks[i].corners);
+		}
+		std::vector<uint32_t>().swap(table);
+		if (dropped > 0) {
+			std::cout << "ERROR : ObjModel::load - Dropped " << dropped << " faces with invalid indices in " << fileName << std::endl;
+		}
+
+		// Smooth normals per position for corners that have none
+		bool needsNormals = false;
+		for (size_t u = 0; u < unique.size() && !needsNormals; u++) {
+			needsNormals = unique[u].normal == MISSING;
+		}
+		std::vector<glm::vec3> faceNormals;
+		if (needsNormals) {
+			faceNormals.assign(positionCount, glm::vec3(0.f));
+			for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+				int32_t a = unique[indices[i]].position;
+				int32_t b = unique[indices[i + 1]].position;
+				int32_t c = unique[indices[i + 2]].position;
+				glm::vec3 normal = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+				faceNormals[a] += normal;
+				faceNormals[b] += normal;
+				faceNormals[c] += normal;
+			}
+		}
+
+		std::vector<Vertex> vertices(unique.size());
+		for (size_t u = 0; u < unique.size(); u++) {
+			const Corner& corner = unique[u];
+			Vertex& vertex = vertices[u];
+			vertex.position = positions[corner.position];
+			vertex.color = hasColors ? colors[corner.position] : glm::vec3(1.f);
+			vertex.texcoord = corner.texcoord != MISSING ? texcoords[corner.texcoord] : glm::vec2(0.f);
+			if (corner.normal != MISSING) {
+				vertex.normal = normals[corner.normal];
+			}
+			else {
+				float length = glm::length(faceNormals[corner.position]);
+				vertex.normal = length > 0.f ? faceNormals[corner.position] / length : glm::vec3(0.f, 1.f, 0.f);
+			}
+		}
+
+		this->set(vertices.data(), static_cast<unsigned>(vertices.size()), indices.data(), static_cast<unsigned>(indices.size()));
+		this->loaded = true;
+	}
+
+public:
+	// Constructor, pool is borrowed for parsing, without one a pool is made for large files
+	ObjModel(const std::string& fileName, ThreadPool* pool = NULL) : Primitive() {
+		this->loaded = false;
+		this->load(fileName, pool);
+	}
+
+	// Destructor
+	virtual ~ObjModel() {
+
+	}
+
+	// False if the file could not be read or declares no vertices
+	inline bool isLoaded() const {
+		return this->loaded;
+	}
+};
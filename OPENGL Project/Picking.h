@@ -0,0 +1,151 @@
+#pragma once
+
+#include<iostream>
+#include<string>
+
+#include<glew.h>
+#include<glfw3.h>
+
+#include"GLState.h"
+#include"Shader.h"
+#include"RenderQueue.h"
+
+// Picks objects by rendering their ids into an integer attachment
+// Only the pixel under the cursor is drawn and read back through a pixel buffer object,
+// a fence tells when the copy is done so the CPU never waits on the GPU
+class GpuPicker {
+private:
+	Shader* shader;
+	GLuint FBO;
+	GLuint colorBuffer;
+	GLuint depthBuffer;
+	GLuint PBO;
+	GLsync fence;
+	int width;
+	int height;
+
+	// Pixel waiting to be rendered, -1 if no click is pending
+	int requestX;
+	int requestY;
+
+	void initTargets(int width, int height) {
+		this->width = width;
+		this->height = height;
+
+		glGenRenderbuffers(1, &this->colorBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, this->colorBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_R32UI, width, height);
+
+		glGenRenderbuffers(1, &this->depthBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, this->depthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		glGenFramebuffers(1, &this->FBO);
+		glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->colorBuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->depthBuffer);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "ERROR : GpuPicker::initTargets - Framebuffer is not complete" << std::endl;
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	void deleteTargets() {
+		glDeleteFramebuffers(1, &this->FBO);
+		glDeleteRenderbuffers(1, &this->colorBuffer);
+		glDeleteRenderbuffers(1, &this->depthBuffer);
+	}
+
+public:
+	// Constructor, defines have to match those of the scene shaders
+	GpuPicker(int width, int height, const std::string& defines = "") {
+		this->shader = new Shader("vertex_core.glsl", "id_fragment.glsl", "", defines);
+		this->fence = 0;
+		this->requestX = -1;
+		this->requestY = -1;
+
+		this->initTargets(width, height);
+
+		glGenBuffers(1, &this->PBO);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, this->PBO);
+		glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(GLuint), NULL, GL_STREAM_READ);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	// Destructor
+	~GpuPicker() {
+		if (this->fence) {
+			glDeleteSync(this->fence);
+		}
+		glDeleteBuffers(1, &this->PBO);
+		this->deleteTargets();
+		delete this->shader;
+	}
+
+	// Ask for the object at framebuffer pixel x, y (origin bottom left)
+	void request(int x, int y) {
+		this->requestX = x;
+		this->requestY = y;
+	}
+
+	inline bool isPending() const {
+		return this->requestX >= 0 || this->fence != 0;
+	}
+
+	// Draw the ids of the packets just flushed by queue at the requested pixel and start the readback
+	// Does nothing when no click is pending
+	void render(GLStateCache& state, RenderQueue& queue, int framebufferWidth, int framebufferHeight) {
+		if (this->requestX < 0 || this->fence != 0) {
+			return;
+		}
+		if (framebufferWidth != this->width || framebufferHeight != this->height) {
+			this->deleteTargets();
+			this->initTargets(framebufferWidth, framebufferHeight);
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+
+		// Only the clicked pixel is cleared and shaded
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(this->requestX, this->requestY, 1, 1);
+		GLuint clearId[4] = { 0, 0, 0, 0 };
+		glClearBufferuiv(GL_COLOR, 0, clearId);
+		glClear(GL_DEPTH_BUFFER_BIT);
+
+		queue.redraw(state, this->shader);
+
+		// Copy into the PBO, returns immediately
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, this->PBO);
+		glReadPixels(this->requestX, this->requestY, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, 0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		this->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		glDisable(GL_SCISSOR_TEST);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		this->requestX = -1;
+		this->requestY = -1;
+	}
+
+	// Non blocking check for a finished readback
+	// Returns true and sets objectId (0 = nothing) once the copy is done
+	bool poll(GLuint& objectId) {
+		if (this->fence == 0) {
+			return false;
+		}
+		GLenum status = glClientWaitSync(this->fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+			return false;
+		}
+		glDeleteSync(this->fence);
+		this->fence = 0;
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, this->PBO);
+		GLuint* pixel = static_cast<GLuint*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(GLuint), GL_MAP_READ_BIT));
+		objectId = pixel ? *pixel : 0;
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		return true;
+	}
+};
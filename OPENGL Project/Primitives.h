@@ -2,6 +2,7 @@
 
 #include<vector>
 #include"Vertex.h"
+#include"Bounds.h"
 #include<glew.h>
 #include<glfw3.h>
 
@@ -9,6 +10,23 @@ class Primitive {
 private:
 	std::vector<Vertex> vertices;
 	std::vector<GLuint> indices;
+
+	// Local bounds, computed whenever the vertices are set
+	AABB bounds;
+	BoundingSphere sphere;
+
+	void computeBounds() {
+		this->bounds = AABB();
+		for (size_t i = 0; i < this->vertices.size(); i++) {
+			this->bounds.expand(this->vertices[i].position);
+		}
+
+		// Sphere around the box center, tighter than the box corners for most shapes
+		this->sphere = BoundingSphere(this->bounds.valid() ? this->bounds.center() : glm::vec3(0.f), 0.f);
+		for (size_t i = 0; i < this->vertices.size(); i++) {
+			this->sphere.radius = glm::max(this->sphere.radius, glm::length(this->vertices[i].position - this->sphere.center));
+		}
+	}
 public:
 	Primitive() {
 
@@ -17,15 +35,11 @@ public:
 
 	}
 
+	// Replaces the vertices and indices
 	void set(const Vertex* vertecis, const unsigned nVertecis, const GLuint* indices, const unsigned nIndecis) {
-		for (size_t i = 0; i < nVertecis; i++)
-		{
-			this->vertices.push_back(vertecis[i]);
-		}
-		for (size_t i = 0; i < nIndecis; i++)
-		{
-			this->indices.push_back(indices[i]);
-		}
+		this->vertices.assign(vertecis, vertecis + nVertecis);
+		this->indices.assign(indices, indices + nIndecis);
+		this->computeBounds();
 	}
 
 	inline Vertex* getVertices() {
@@ -43,6 +57,14 @@ public:
 	inline const unsigned getNindices() {
 		return this->indices.size();
 	}
+
+	inline const AABB& getBounds() const {
+		return this->bounds;
+	}
+
+	inline const BoundingSphere& getSphere() const {
+		return this->sphere;
+	}
 };
 
 class Triangle : public Primitive {
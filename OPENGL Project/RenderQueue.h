@@ -0,0 +1,240 @@
+#pragma once
+
+#include<vector>
+#include<cstdint>
+#include<cstring>
+
+#include<glew.h>
+#include<glfw3.h>
+#include<glm.hpp>
+#include<vec3.hpp>
+
+#include"Vertex.h"
+#include"GLState.h"
+#include"Geometry.h"
+#include"Shader.h"
+#include"TextureArray.h"
+#include"Material.h"
+#include"Mesh.h"
+#include"Instancing.h"
+
+// Render passes, lower passes are drawn first
+enum RenderPass {
+	PASS_OPAQUE = 0,
+	PASS_BLENDED = 1
+};
+
+// One queued draw, the key packs everything the submission order depends on
+struct DrawPacket {
+	uint64_t key;
+	Mesh* mesh;
+	Shader* shader;
+	GLuint objectId;
+};
+
+// Collects draw packets each frame, radix sorts them by key and submits them
+// Opaque key  : pass 2 | program 6 | diffuse array 8 | specular array 8 | geometry 10 | material 8 | depth 22
+// Blended key : pass 2 | inverted depth 22 | program 6 | diffuse array 8 | specular array 8 | geometry 10 | material 8
+// Opaque packets sharing state end up adjacent and front-to-back, blended packets back-to-front
+// Materials are indexed per instance, so packets differing only in material still share a draw
+class RenderQueue {
+private:
+	static const unsigned DEPTH_BITS = 22;
+	static const uint64_t DEPTH_MAX = (1ull << DEPTH_BITS) - 1;
+
+	std::vector<DrawPacket> packets;
+	std::vector<DrawPacket> scratch;
+	std::vector<InstanceData> instances;
+	InstanceBuffer buffer;
+
+	glm::vec3 viewPosition;
+	glm::vec3 viewFront;
+	float drawDistance;
+
+	// Name of array in sort keys, 0 on the bindless path where nothing is bound
+	static GLuint arrayId(const TextureArray* array) {
+		return array ? array->getId() : 0;
+	}
+
+	// State part of the key, 40 bits
+	static uint64_t stateBits(Shader* shader, Material* material, Geometry* geometry) {
+		return (static_cast<uint64_t>(shader->getId() & 0x3F) << 34)
+			| (static_cast<uint64_t>(arrayId(material->getDiffuseArray()) & 0xFF) << 26)
+			| (static_cast<uint64_t>(arrayId(material->getSpecularArray()) & 0xFF) << 18)
+			| (static_cast<uint64_t>(geometry->getVAO() & 0x3FF) << 8)
+			| (static_cast<uint64_t>(material->getId() & 0xFF));
+	}
+
+	// View depth quantized to DEPTH_BITS over [0, drawDistance]
+	uint64_t depthBits(const glm::vec3& position) const {
+		float depth = glm::dot(position - this->viewPosition, this->viewFront) / this->drawDistance;
+		if (depth < 0.f) {
+			depth = 0.f;
+		}
+		else if (depth > 1.f) {
+			depth = 1.f;
+		}
+		return static_cast<uint64_t>(depth * DEPTH_MAX);
+	}
+
+	// LSD radix sort, 8 bits per pass, passes where every key shares the digit are skipped
+	void sort() {
+		size_t count = this->packets.size();
+		this->scratch.resize(count);
+
+		DrawPacket* source = this->packets.data();
+		DrawPacket* target = this->scratch.data();
+		for (unsigned shift = 0; shift < 64; shift += 8) {
+			size_t histogram[256];
+			std::memset(histogram, 0, sizeof(histogram));
+			for (size_t i = 0; i < count; i++) {
+				histogram[(source[i].key >> shift) & 0xFF]++;
+			}
+			if (histogram[(source[0].key >> shift) & 0xFF] == count) {
+				continue;
+			}
+
+			size_t offset = 0;
+			for (unsigned digit = 0; digit < 256; digit++) {
+				size_t digitCount = histogram[digit];
+				histogram[digit] = offset;
+				offset += digitCount;
+			}
+			for (size_t i = 0; i < count; i++) {
+				target[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+			}
+
+			DrawPacket* swap = source;
+			source = target;
+			target = swap;
+		}
+
+		if (source != this->packets.data()) {
+			this->packets.swap(this->scratch);
+		}
+	}
+
+	// Packets drawn by one instanced call must match in everything but the transform and material layers
+	static bool sameBatch(const DrawPacket& a, const DrawPacket& b) {
+		Material* materialA = a.mesh->getMaterial();
+		Material* materialB = b.mesh->getMaterial();
+		return a.shader == b.shader
+			&& a.mesh->getGeometry() == b.mesh->getGeometry()
+			&& materialA->getDiffuseArray() == materialB->getDiffuseArray()
+			&& materialA->getSpecularArray() == materialB->getSpecularArray();
+	}
+
+	static RenderPass passOf(const DrawPacket& packet) {
+		return static_cast<RenderPass>(packet.key >> 62);
+	}
+
+public:
+	// Constructor
+	RenderQueue() {
+		this->viewPosition = glm::vec3(0.f);
+		this->viewFront = glm::vec3(0.f, 0.f, -1.f);
+		this->drawDistance = 1.f;
+	}
+
+	// Destructor
+	~RenderQueue() {
+
+	}
+
+	// Start a frame seen from position looking along front
+	void begin(const glm::vec3& position, const glm::vec3& front, float drawDistance) {
+		this->packets.clear();
+		this->viewPosition = position;
+		this->viewFront = front;
+		this->drawDistance = drawDistance;
+	}
+
+	// Queue mesh to be drawn with shader, objectId is what the picking pass writes for it
+	void submit(Mesh* mesh, Shader* shader, GLuint objectId = 0) {
+		Material* material = mesh->getMaterial();
+		uint64_t state = stateBits(shader, material, mesh->getGeometry().get());
+		uint64_t depth = this->depthBits(mesh->getPosition());
+
+		DrawPacket packet;
+		if (material->isBlended()) {
+			packet.key = (static_cast<uint64_t>(PASS_BLENDED) << 62) | ((DEPTH_MAX - depth) << 40) | state;
+		}
+		else {
+			packet.key = (static_cast<uint64_t>(PASS_OPAQUE) << 62) | (state << DEPTH_BITS) | depth;
+		}
+		packet.mesh = mesh;
+		packet.shader = shader;
+		packet.objectId = objectId;
+		this->packets.push_back(packet);
+	}
+
+	// Sort, upload every instance at once and draw each run of matching packets instanced
+	void flush(GLStateCache& state) {
+		if (this->packets.empty()) {
+			return;
+		}
+		this->sort();
+
+		this->instances.resize(this->packets.size());
+		for (size_t i = 0; i < this->packets.size(); i++) {
+			this->instances[i].ModelMatrix = this->packets[i].mesh->getModelMatrix();
+			this->instances[i].ObjectId = this->packets[i].objectId;
+			this->instances[i].MaterialIndex = this->packets[i].mesh->getMaterial()->getId();
+		}
+		this->buffer.upload(this->instances);
+
+		size_t first = 0;
+		while (first < this->packets.size()) {
+			size_t last = first + 1;
+			while (last < this->packets.size() && passOf(this->packets[last]) == passOf(this->packets[first])
+				&& sameBatch(this->packets[first], this->packets[last])) {
+				last++;
+			}
+
+			const DrawPacket& packet = this->packets[first];
+			Mesh* mesh = packet.mesh;
+			Material* material = mesh->getMaterial();
+
+			// Blended geometry is tested against but does not write depth
+			state.depthMask(passOf(packet) == PASS_BLENDED ? GL_FALSE : GL_TRUE);
+
+			// Use shader
+			packet.shader->use(state);
+
+			// Bind the arrays holding every material of the run, layers come from the material block
+			// Bindless materials carry their own texture handles
+			if (material->getDiffuseArray()) {
+				material->getDiffuseArray()->bind(state, DIFFUSE_UNIT);
+				material->getSpecularArray()->bind(state, SPECULAR_UNIT);
+			}
+
+			// Draw every instance of the run
+			mesh->getGeometry()->drawInstanced(state, this->buffer.getId(), first * sizeof(InstanceData), static_cast<GLsizei>(last - first));
+
+			first = last;
+		}
+
+		state.depthMask(GL_TRUE);
+	}
+
+	// Draw the packets of the last flush again with one shader and no materials or textures
+	// Reuses the sorted order and the uploaded instance buffer, used by the picking pass
+	void redraw(GLStateCache& state, Shader* shader) {
+		shader->use(state);
+
+		size_t first = 0;
+		while (first < this->packets.size()) {
+			size_t last = first + 1;
+			while (last < this->packets.size() && this->packets[last].mesh->getGeometry() == this->packets[first].mesh->getGeometry()) {
+				last++;
+			}
+			this->packets[first].mesh->getGeometry()->drawInstanced(state, this->buffer.getId(), first * sizeof(InstanceData), static_cast<GLsizei>(last - first));
+			first = last;
+		}
+	}
+
+	// Getters
+	inline size_t getPacketCount() const {
+		return this->packets.size();
+	}
+};
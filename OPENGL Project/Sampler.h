@@ -0,0 +1,97 @@
+#pragma once
+
+#include<iostream>
+#include<algorithm>
+
+#include<glew.h>
+
+// Sampler object shared by every texture drawn with the same filtering
+// Replaces the filter and wrap parameters of the texture on the units it is bound to
+class Sampler {
+private:
+	GLuint id;
+	GLenum minFilter;
+	GLenum magFilter;
+	GLenum wrap;
+	float anisotropy;
+
+	// Bumped on every change, lets bindless handles notice they were built from stale state
+	unsigned version;
+
+public:
+	// Constructor, anisotropy above 1 needs EXT_texture_filter_anisotropic and is clamped to the driver maximum
+	Sampler(GLenum minFilter = GL_LINEAR_MIPMAP_LINEAR, GLenum magFilter = GL_LINEAR, GLenum wrap = GL_REPEAT, float anisotropy = 1.f) {
+		glGenSamplers(1, &this->id);
+		this->version = 0;
+		this->wrap = wrap;
+		glSamplerParameteri(this->id, GL_TEXTURE_WRAP_S, wrap);
+		glSamplerParameteri(this->id, GL_TEXTURE_WRAP_T, wrap);
+		this->setFilters(minFilter, magFilter);
+		this->anisotropy = 1.f;
+		this->setAnisotropy(anisotropy);
+	}
+
+	// Destructor
+	~Sampler() {
+		glDeleteSamplers(1, &this->id);
+	}
+
+	Sampler(const Sampler&) = delete;
+	Sampler& operator=(const Sampler&) = delete;
+
+	// Largest anisotropy the driver accepts, 1 without the extension
+	static float getMaxAnisotropy() {
+		if (!GLEW_EXT_texture_filter_anisotropic) {
+			return 1.f;
+		}
+		GLfloat maximum = 1.f;
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maximum);
+		return maximum;
+	}
+
+	// Setters
+	void setFilters(GLenum minFilter, GLenum magFilter) {
+		this->minFilter = minFilter;
+		this->magFilter = magFilter;
+		this->version++;
+		glSamplerParameteri(this->id, GL_TEXTURE_MIN_FILTER, minFilter);
+		glSamplerParameteri(this->id, GL_TEXTURE_MAG_FILTER, magFilter);
+	}
+
+	void setAnisotropy(float anisotropy) {
+		if (!GLEW_EXT_texture_filter_anisotropic) {
+			if (anisotropy > 1.f) {
+				std::cout << "ERROR : Sampler::setAnisotropy - Anisotropic filtering is not supported" << std::endl;
+			}
+			return;
+		}
+		this->anisotropy = std::min(std::max(anisotropy, 1.f), getMaxAnisotropy());
+		this->version++;
+		glSamplerParameterf(this->id, GL_TEXTURE_MAX_ANISOTROPY_EXT, this->anisotropy);
+	}
+
+	// Getters
+	inline GLuint getId() const {
+		return this->id;
+	}
+
+	inline float getAnisotropy() const {
+		return this->anisotropy;
+	}
+
+	inline GLenum getMinFilter() const {
+		return this->minFilter;
+	}
+
+	inline GLenum getMagFilter() const {
+		return this->magFilter;
+	}
+
+	inline GLenum getWrap() const {
+		return this->wrap;
+	}
+
+	inline unsigned getVersion() const {
+		return this->version;
+	}
+};
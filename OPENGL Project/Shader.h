@@ -3,6 +3,8 @@
 #include<iostream>
 #include<fstream>
 #include<string>
+#include<vector>
+#include<unordered_map>
 
 #include<glew.h>
 #include<glfw3.h>
@@ -14,12 +16,17 @@
 #include<gtc/matrix_transform.hpp>
 #include<gtc/type_ptr.hpp>
 
+#include"GLState.h"
+
 class Shader {
 private:
 	// Variables
 	// Shader Program ID
 	GLuint id;
 
+	// Active uniform name -> location, filled once after linking
+	std::unordered_map<std::string, GLint> uniformLocations;
+
 	// File Reader
 	std::string loadShaderSource(const char* filename) {
 		std::string temp = "";
@@ -41,14 +48,27 @@ private:
 		return src;
 	}
 
+	// Insert defines right after the #version line, which has to stay first
+	static std::string injectDefines(const std::string& src, const std::string& defines) {
+		if (defines.empty()) {
+			return src;
+		}
+		size_t version = src.find("#version");
+		size_t lineEnd = version == std::string::npos ? std::string::npos : src.find('\n', version);
+		if (lineEnd == std::string::npos) {
+			return defines + src;
+		}
+		return src.substr(0, lineEnd + 1) + defines + src.substr(lineEnd + 1);
+	}
+
 	// Loads and returns Shader (Vertex or Fragment) from file
-	GLuint loadShader(GLenum type,const char* filename) {
+	GLuint loadShader(GLenum type,const char* filename, const std::string& defines = "") {
 		char infoLog[512];
 		GLint success;
 		
 		GLuint shader = glCreateShader(type);
 		
-		std::string str_src = this->loadShaderSource(filename);
+		std::string str_src = injectDefines(this->loadShaderSource(filename), defines);
 		const GLchar* src = str_src.c_str();
 		
 		glShaderSource(shader, 1, &src, NULL);
@@ -92,24 +112,56 @@ private:
 
 	}
 
+	// Reflects every active uniform of the linked program into the location table
+	void reflectUniforms() {
+		GLint count = 0;
+		GLint maxLength = 0;
+		glGetProgramiv(this->id, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(this->id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+		std::vector<GLchar> name(maxLength > 0 ? maxLength : 1);
+		for (GLint i = 0; i < count; i++) {
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(this->id, i, maxLength, &length, &size, &type, name.data());
+
+			std::string uniformName(name.data(), length);
+			GLint location = glGetUniformLocation(this->id, uniformName.c_str());
+
+			// Uniforms inside blocks have no location
+			if (location == -1) {
+				continue;
+			}
+			this->uniformLocations[uniformName] = location;
+
+			// Arrays are reported as "name[0]", also make them reachable by "name"
+			if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0) {
+				this->uniformLocations[uniformName.substr(0, uniformName.size() - 3)] = location;
+			}
+		}
+	}
+
 public:
 	// Constructor
-	Shader(const char* vertexFile,const char* fragmentFile,const char* geometryFile = "") {
+	// defines, like "#define BINDLESS\n", are compiled into every stage
+	Shader(const char* vertexFile,const char* fragmentFile,const char* geometryFile = "", const std::string& defines = "") {
 		GLuint vertexShader = 0;
 		GLuint geometryShader = 0;
 		GLuint fragmentShader = 0;
 
 		// Load Vertex and Fragment Shaders
-		vertexShader = loadShader(GL_VERTEX_SHADER, vertexFile);
-		fragmentShader = loadShader(GL_FRAGMENT_SHADER, fragmentFile);
+		vertexShader = loadShader(GL_VERTEX_SHADER, vertexFile, defines);
+		fragmentShader = loadShader(GL_FRAGMENT_SHADER, fragmentFile, defines);
 
 		// Load Geometry Shader if given any
 		if (geometryFile != "") {
-			geometryShader = loadShader(GL_GEOMETRY_SHADER, geometryFile);
+			geometryShader = loadShader(GL_GEOMETRY_SHADER, geometryFile, defines);
 		}
 
 		// Links shaders to shader program
 		this->linkProgram(vertexShader, geometryShader, fragmentShader);
+		this->reflectUniforms();
 
 		// Clean up
 		glDeleteShader(vertexShader);
@@ -127,51 +179,86 @@ public:
 		glUseProgram(this->id);
 	}
 
+	// Use through the state cache, skipped if already in use
+	void use(GLStateCache& state) {
+		state.useProgram(this->id);
+	}
+
 	void unuse() {
 		glUseProgram(0);
 	}
 
+	// Getters
+	inline GLuint getId() const {
+		return this->id;
+	}
+
+
+	// Uniform location handle, -1 if the uniform is not active in this program
+	GLint getUniformLocation(const GLchar* name) const {
+		std::unordered_map<std::string, GLint>::const_iterator it = this->uniformLocations.find(name);
+		if (it == this->uniformLocations.end()) {
+			return -1;
+		}
+		return it->second;
+	}
+
+	// Send Uniforms to shader program using location handles
+	// Uses direct state access so the program does not need to be bound
+	void setVec4f(glm::fvec4 value, GLint location) {
+		glProgramUniform4fv(this->id, location, 1, glm::value_ptr(value));
+	}
+
+	void setVec3f(glm::fvec3 value, GLint location) {
+		glProgramUniform3fv(this->id, location, 1, glm::value_ptr(value));
+	}
+
+	void setVec2f(glm::fvec2 value, GLint location) {
+		glProgramUniform2fv(this->id, location, 1, glm::value_ptr(value));
+	}
+
+	void setVec1f(GLfloat value, GLint location) {
+		glProgramUniform1f(this->id, location, value);
+	}
+
+	void setMat4fv(const glm::mat4& value, GLint location, GLboolean transpose = GL_FALSE) {
+		glProgramUniformMatrix4fv(this->id, location, 1, transpose, glm::value_ptr(value));
+	}
+
+	void setMat3fv(const glm::mat3& value, GLint location, GLboolean transpose = GL_FALSE) {
+		glProgramUniformMatrix3fv(this->id, location, 1, transpose, glm::value_ptr(value));
+	}
+
+	void set1i(GLint value, GLint location) {
+		glProgramUniform1i(this->id, location, value);
+	}
 
-	// Send Uniforms to shader program
+	// Send Uniforms to shader program by name
 	void setVec4f(glm::fvec4 value, const GLchar* name) {
-		this->use();
-		glUniform4fv(glGetUniformLocation(this->id, name), 1, glm::value_ptr(value));
-		this->unuse();
+		this->setVec4f(value, this->getUniformLocation(name));
 	}
 
 	void setVec3f(glm::fvec3 value, const GLchar* name) {
-		this->use();
-		glUniform3fv(glGetUniformLocation(this->id, name), 1, glm::value_ptr(value));
-		this->unuse();
+		this->setVec3f(value, this->getUniformLocation(name));
 	}
 
 	void setVec2f(glm::fvec2 value, const GLchar* name) {
-		this->use();
-		glUniform2fv(glGetUniformLocation(this->id, name), 1, glm::value_ptr(value));
-		this->unuse();
+		this->setVec2f(value, this->getUniformLocation(name));
 	}
 
 	void setVec1f(GLfloat value, const GLchar* name) {
-		this->use();
-		glUniform1f(glGetUniformLocation(this->id, name), value);
-		this->unuse();
+		this->setVec1f(value, this->getUniformLocation(name));
 	}
 
-	void setMat4fv(glm::mat4 value, const GLchar* name, GLboolean transpose = GL_FALSE) {
-		this->use();
-		glUniformMatrix4fv(glGetUniformLocation(this->id, name), 1, transpose, glm::value_ptr(value));
-		this->unuse();
+	void setMat4fv(const glm::mat4& value, const GLchar* name, GLboolean transpose = GL_FALSE) {
+		this->setMat4fv(value, this->getUniformLocation(name), transpose);
 	}
 
-	void setMat3fv(glm::mat3 value, const GLchar* name, GLboolean transpose = GL_FALSE) {
-		this->use();
-		glUniformMatrix3fv(glGetUniformLocation(this->id, name), 1, transpose, glm::value_ptr(value));
-		this->unuse();
+	void setMat3fv(const glm::mat3& value, const GLchar* name, GLboolean transpose = GL_FALSE) {
+		this->setMat3fv(value, this->getUniformLocation(name), transpose);
 	}
 
 	void set1i(GLint value, const GLchar* name) {
-		this->use();
-		glUniform1i(glGetUniformLocation(this->id, name), value);
-		this->unuse();
+		this->set1i(value, this->getUniformLocation(name));
 	}
 };
\ No newline at end of file
@@ -7,94 +7,224 @@
 #include<glfw3.h>
 #include<SOIL2.h>
 
+#include"GLState.h"
+#include"Sampler.h"
+#include"TextureCooker.h"
+
 class Texture {
 private:
 	GLuint id;
 	int height, width;
 	unsigned int type;
+	bool resident;
+	size_t memory;
+	GLenum format;
+	GLsizei levels;
+
+	// Filtering used when bound through the state cache, texture parameters otherwise
+	const Sampler* sampler;
+
+	// Full mip chain down to 1x1
+	static GLsizei levelCount(int width, int height) {
+		GLsizei levels = 1;
+		int size = width > height ? width : height;
+		while (size > 1) {
+			size >>= 1;
+			levels++;
+		}
+		return levels;
+	}
 
-public:
-	Texture(const char* fileName, GLenum type) {
-		this->type = type;
-
-		unsigned char* image = SOIL_load_image(fileName, &this->width, &this->height, NULL, SOIL_LOAD_RGBA);
+	// New immutable storage, storage can not be resized so the old texture object is replaced
+	// The id changes, bindings cached in GLStateCache must be invalidated before the next draw
+	void allocate(GLsizei levels, GLenum internalFormat, int width, int height) {
+		if (this->id) {
+			glDeleteTextures(1, &this->id);
+		}
+		this->width = width;
+		this->height = height;
+		this->format = internalFormat;
+		this->levels = levels;
 
 		glGenTextures(1, &this->id);
-		glBindTexture(type, this->id);
+		glBindTexture(this->type, this->id);
+		glTexStorage2D(this->type, levels, internalFormat, width, height);
 
 		// Options if texture is less than plain
-		glTexParameteri(type, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(type, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// Antialiasing magnification and minification
-		glTexParameteri(type, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(type, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(this->type, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(this->type, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		// Trilinear minification and linear magnification, samplers override these
+		glTexParameteri(this->type, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(this->type, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
 
-		if (image)
-		{
-			glTexImage2D(type, 0, GL_RGBA, this->width, this->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-			glGenerateMipmap(type);
+	void specifyCompressed(const CookedImage& image, bool buffered, GLintptr offset) {
+		GLsizei levels = static_cast<GLsizei>(image.levels.size());
+		this->allocate(levels, image.format, image.width, image.height);
+
+		size_t total = 0;
+		for (GLsizei level = 0; level < levels; level++) {
+			int levelWidth = image.width >> level > 0 ? image.width >> level : 1;
+			int levelHeight = image.height >> level > 0 ? image.height >> level : 1;
+			GLsizei size = static_cast<GLsizei>(image.levels[level].size());
+			const void* pixels = buffered ? reinterpret_cast<const void*>(offset + total) : image.levels[level].data();
+			glCompressedTexSubImage2D(this->type, level, 0, 0, levelWidth, levelHeight, image.format, size, pixels);
+			total += size;
 		}
-		else {
-			std::cout << "error can not load texture " << fileName << std::endl;
+
+		// Single channel specular maps read as grey
+		if (image.format == GL_COMPRESSED_RED_RGTC1) {
+			glTexParameteri(this->type, GL_TEXTURE_SWIZZLE_G, GL_RED);
+			glTexParameteri(this->type, GL_TEXTURE_SWIZZLE_B, GL_RED);
 		}
+		glBindTexture(this->type, 0);
+
+		this->resident = true;
+		this->memory = total;
+	}
+
+	// RGBA8 level 0, the rest of the chain is generated
+	void specify(int width, int height, const void* pixels) {
+		this->allocate(levelCount(width, height), GL_RGBA8, width, height);
+		glTexSubImage2D(this->type, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		glGenerateMipmap(this->type);
+		glBindTexture(this->type, 0);
 
-		glActiveTexture(0);
+		this->resident = true;
+		this->memory = static_cast<size_t>(width) * height * 4 * 4 / 3;
+	}
+
+public:
+	Texture(const char* fileName, GLenum type) {
+		this->id = 0;
+		this->format = GL_RGBA8;
+		this->levels = 0;
+		this->type = type;
+		this->resident = false;
+		this->memory = 0;
+		this->sampler = nullptr;
+
+		this->loadFromFile(fileName);
+	}
+
+	// Usable right away with a 1x1 grey placeholder, the image is given later through upload
+	Texture(GLenum type) {
+		this->id = 0;
+		this->type = type;
+		this->sampler = nullptr;
+
+		const unsigned char placeholder[4] = { 128, 128, 128, 255 };
+
+		this->allocate(1, GL_RGBA8, 1, 1);
+		glTexSubImage2D(type, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
 		glBindTexture(type, 0);
-		SOIL_free_image_data(image);
+
+		this->resident = false;
+		this->memory = 4;
 	}
 
 	Texture() {
-
+		this->id = 0;
+		this->width = 0;
+		this->height = 0;
+		this->type = GL_TEXTURE_2D;
+		this->resident = false;
+		this->memory = 0;
+		this->format = GL_RGBA8;
+		this->levels = 0;
+		this->sampler = nullptr;
 	}
 
 	~Texture(){
 		glDeleteTextures(1, &this->id);
 	}
 
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+
 	inline GLuint getId() const {
 		return this->id;
 	}
 
+	inline int getWidth() const {
+		return this->width;
+	}
+
+	inline int getHeight() const {
+		return this->height;
+	}
+
+	// Internal format of the storage, GL_RGBA8 or a compressed format
+	inline GLenum getFormat() const {
+		return this->format;
+	}
+
+	inline GLsizei getLevels() const {
+		return this->levels;
+	}
+
+	// Bytes of GPU memory used by all levels, estimated for generated mipmaps
+	inline size_t getMemory() const {
+		return this->memory;
+	}
+
+	// False while the placeholder is still in use
+	inline bool isResident() const {
+		return this->resident;
+	}
+
+	inline const Sampler* getSampler() const {
+		return this->sampler;
+	}
+
+	void setSampler(const Sampler* sampler) {
+		this->sampler = sampler;
+	}
+
+	// Replace the image with RGBA8 pixels, with a pixel unpack buffer bound pixels is an offset into it
+	void upload(int width, int height, const void* pixels) {
+		this->specify(width, height, pixels);
+	}
+
+	// Replace the image with a cooked mip chain, no mipmaps are generated
+	void uploadCompressed(const CookedImage& image) {
+		this->specifyCompressed(image, false, 0);
+	}
+
+	// Same with the levels stored back to back at offset in the bound pixel unpack buffer
+	void uploadCompressed(const CookedImage& image, GLintptr offset) {
+		this->specifyCompressed(image, true, offset);
+	}
+
 	void bind(const GLint texture_unit) {
 		glActiveTexture(GL_TEXTURE0 + texture_unit);
 		glBindTexture(this->type, this->id);
 	}
 
-	void unbind() {
-		glActiveTexture(0);
+	// Bind through the state cache with the shared sampler, skipped if already bound to texture_unit
+	void bind(GLStateCache& state, const GLint texture_unit) {
+		state.bindTexture(texture_unit, this->type, this->id);
+		state.bindSampler(texture_unit, this->sampler ? this->sampler->getId() : 0);
+	}
+
+	void unbind(const GLint texture_unit = 0) {
+		glActiveTexture(GL_TEXTURE0 + texture_unit);
 		glBindTexture(this->type, 0);
 	}
 
 
 	void loadFromFile(const char* fileName) {
-		if (this->id) {
-			glDeleteTextures(1, &this->id);
-		}
-
 		unsigned char* image = SOIL_load_image(fileName, &this->width, &this->height, NULL, SOIL_LOAD_RGBA);
 
-		glGenTextures(1, &this->id);
-		glBindTexture(this->type, this->id);
-
-		// Options if texture is less than plain
-		glTexParameteri(this->type, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(this->type, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// Antialiasing magnification and minification
-		glTexParameteri(this->type, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(this->type, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-
 		if (image)
 		{
-			glTexImage2D(this->type, 0, GL_RGBA, this->width, this->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-			glGenerateMipmap(this->type);
+			this->specify(this->width, this->height, image);
 		}
 		else {
 			std::cout << "error can not load texture " << fileName << std::endl;
 		}
 
-		glActiveTexture(0);
-		glBindTexture(this->type, 0);
 		SOIL_free_image_data(image);
 
 	}
-};
\ No newline at end of file
+};
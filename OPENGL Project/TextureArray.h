@@ -0,0 +1,122 @@
+#pragma once
+
+#include<iostream>
+
+#include<glew.h>
+
+#include"GLState.h"
+#include"Sampler.h"
+#include"Texture.h"
+
+// GL_TEXTURE_2D_ARRAY of images sharing size, format and level count
+// Layers are copied on the GPU from 2D textures, so the sources can be released afterwards.
+// Capacity doubles when full; growing replaces the texture object, so the id changes and
+// bindings cached in GLStateCache must be invalidated before the next draw
+class TextureArray {
+private:
+	GLuint id;
+	GLenum format;
+	int width;
+	int height;
+	GLsizei levels;
+	int layers;
+	int capacity;
+	const Sampler* sampler;
+
+	void allocate(int capacity) {
+		GLuint previous = this->id;
+
+		glGenTextures(1, &this->id);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, this->id);
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, this->levels, this->format, this->width, this->height, capacity);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, this->levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		// Single channel specular maps read as grey
+		if (this->format == GL_COMPRESSED_RED_RGTC1) {
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_G, GL_RED);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_B, GL_RED);
+		}
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+		// Carry the filled layers over
+		if (previous) {
+			for (GLsizei level = 0; level < this->levels; level++) {
+				glCopyImageSubData(previous, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+					this->id, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+					levelSize(this->width, level), levelSize(this->height, level), this->layers);
+			}
+			glDeleteTextures(1, &previous);
+		}
+		this->capacity = capacity;
+	}
+
+	static int levelSize(int size, GLsizei level) {
+		return size >> level > 0 ? size >> level : 1;
+	}
+
+public:
+	// Constructor, storage for capacity layers
+	TextureArray(GLenum format, int width, int height, GLsizei levels, const Sampler* sampler, int capacity = 4) {
+		this->id = 0;
+		this->format = format;
+		this->width = width;
+		this->height = height;
+		this->levels = levels;
+		this->layers = 0;
+		this->capacity = 0;
+		this->sampler = sampler;
+		this->allocate(capacity > 0 ? capacity : 1);
+	}
+
+	// Destructor
+	~TextureArray() {
+		glDeleteTextures(1, &this->id);
+	}
+
+	TextureArray(const TextureArray&) = delete;
+	TextureArray& operator=(const TextureArray&) = delete;
+
+	// Whether texture can become a layer of this array
+	bool accepts(const Texture& texture) const {
+		return texture.getFormat() == this->format && texture.getWidth() == this->width
+			&& texture.getHeight() == this->height && texture.getLevels() == this->levels;
+	}
+
+	// Copy every level of texture into a new layer, returns the layer index or -1
+	int append(const Texture& texture) {
+		if (!this->accepts(texture)) {
+			std::cout << "ERROR : TextureArray::append - Texture does not match the array layout" << std::endl;
+			return -1;
+		}
+		if (this->layers == this->capacity) {
+			this->allocate(this->capacity * 2);
+		}
+
+		for (GLsizei level = 0; level < this->levels; level++) {
+			glCopyImageSubData(texture.getId(), GL_TEXTURE_2D, level, 0, 0, 0,
+				this->id, GL_TEXTURE_2D_ARRAY, level, 0, 0, this->layers,
+				levelSize(this->width, level), levelSize(this->height, level), 1);
+		}
+		return this->layers++;
+	}
+
+	// Bind through the state cache with the shared sampler
+	void bind(GLStateCache& state, GLuint unit) const {
+		state.bindTexture(unit, GL_TEXTURE_2D_ARRAY, this->id);
+		state.bindSampler(unit, this->sampler ? this->sampler->getId() : 0);
+	}
+
+	// Getters
+	inline GLuint getId() const {
+		return this->id;
+	}
+
+	inline int getLayers() const {
+		return this->layers;
+	}
+
+	inline GLenum getFormat() const {
+		return this->format;
+	}
+};
@@ -0,0 +1,203 @@
+#pragma once
+
+#include<iostream>
+#include<fstream>
+#include<string>
+#include<vector>
+#include<memory>
+#include<unordered_map>
+#include<cstdint>
+#include<cstdlib>
+#include<climits>
+
+#include<glew.h>
+
+#include"Texture.h"
+#include"Sampler.h"
+#include"TextureStreamer.h"
+
+// Hands out shared textures, one per distinct image and usage
+// Lookups go by canonical path first, then by a hash of the file contents so
+// the same image under two names is only cooked and uploaded once.
+// Entries nobody references any more stay cached until the estimated GPU memory
+// goes over budget, then the least recently used ones are dropped
+class TextureCache {
+private:
+	struct Entry {
+		std::shared_ptr<Texture> texture;
+		uint64_t size;
+		uint64_t lastUse;
+		std::vector<std::string> paths;
+	};
+
+	TextureStreamer* streamer;
+	const Sampler* sampler;
+	size_t budget;
+	uint64_t clock;
+
+	std::unordered_map<uint64_t, Entry> entries;
+	std::unordered_map<std::string, uint64_t> hashOfPath;
+
+	// Handed out for files that can not be read, grey and never resident
+	std::shared_ptr<Texture> placeholder;
+
+	// The same image cooked for another usage is a different texture
+	static uint64_t entryKey(uint64_t hash, TextureUsage usage) {
+		return (hash ^ static_cast<uint64_t>(usage)) * 1099511628211ULL;
+	}
+
+	static bool readFile(const std::string& path, std::vector<unsigned char>& bytes) {
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file.is_open()) {
+			return false;
+		}
+		std::streamsize size = file.tellg();
+		file.seekg(0, std::ios::beg);
+		bytes.resize(static_cast<size_t>(size));
+		return size == 0 || file.read(reinterpret_cast<char*>(bytes.data()), size).good();
+	}
+
+	static bool evictable(const Entry& entry) {
+		// Not if still used, or if its upload is pending in the streamer
+		return entry.texture.use_count() == 1 && entry.texture->isResident();
+	}
+
+public:
+	// Constructor, every texture is sampled with sampler
+	// budget is the estimated GPU memory in bytes kept for textures
+	TextureCache(TextureStreamer* streamer, const Sampler* sampler, size_t budget = 256 * 1024 * 1024) {
+		this->streamer = streamer;
+		this->sampler = sampler;
+		this->budget = budget;
+		this->clock = 0;
+	}
+
+	TextureCache(const TextureCache&) = delete;
+	TextureCache& operator=(const TextureCache&) = delete;
+
+	// Absolute path with separators and case normalized, the input as is if it does not resolve
+	static std::string canonicalPath(const std::string& path) {
+		std::string result = path;
+#ifdef _WIN32
+		char buffer[_MAX_PATH];
+		if (_fullpath(buffer, path.c_str(), _MAX_PATH)) {
+			result = buffer;
+		}
+		for (size_t i = 0; i < result.size(); i++) {
+			result[i] = result[i] == '\\' ? '/' : static_cast<char>(tolower(static_cast<unsigned char>(result[i])));
+		}
+#else
+		char buffer[PATH_MAX];
+		if (realpath(path.c_str(), buffer)) {
+			result = buffer;
+		}
+#endif
+		return result;
+	}
+
+	// Shared texture for the image at path, starts streaming its cooked version on a miss
+	std::shared_ptr<Texture> acquire(const std::string& path, TextureUsage usage = TEXTURE_DIFFUSE) {
+		this->clock++;
+		std::string canonical = canonicalPath(path);
+
+		std::unordered_map<std::string, uint64_t>::iterator known = this->hashOfPath.find(canonical);
+		if (known != this->hashOfPath.end()) {
+			std::unordered_map<uint64_t, Entry>::iterator entry = this->entries.find(entryKey(known->second, usage));
+			if (entry != this->entries.end()) {
+				entry->second.lastUse = this->clock;
+				return entry->second.texture;
+			}
+		}
+
+		// Missing files are not cached, a file added later under the path is read on the next acquire
+		std::vector<unsigned char> bytes;
+		if (!readFile(canonical, bytes)) {
+			std::cout << "ERROR : TextureCache::acquire - Could not read " << path << std::endl;
+			return this->getPlaceholder();
+		}
+		uint64_t hash = TextureCooker::hashBytes(bytes.data(), bytes.size());
+		uint64_t key = entryKey(hash, usage);
+
+		std::shared_ptr<Texture> texture = std::make_shared<Texture>(GL_TEXTURE_2D);
+		texture->setSampler(this->sampler);
+
+		std::unordered_map<uint64_t, Entry>::iterator same = this->entries.find(key);
+		if (same != this->entries.end()) {
+			// Same contents under another name
+			if (same->second.size == bytes.size()) {
+				this->hashOfPath[canonical] = hash;
+				same->second.lastUse = this->clock;
+				same->second.paths.push_back(canonical);
+				return same->second.texture;
+			}
+			// Hash collision with other contents, the cached entry stays and this image is loaded uncached
+			std::cout << "ERROR : TextureCache::acquire - Hash collision, " << path << " is not cached" << std::endl;
+			this->streamer->loadCooked(texture.get(), path, std::move(bytes), usage);
+			return texture;
+		}
+
+		Entry entry;
+		entry.texture = texture;
+		entry.size = bytes.size();
+		entry.lastUse = this->clock;
+		entry.paths.push_back(canonical);
+		this->streamer->loadCooked(entry.texture.get(), path, std::move(bytes), usage);
+
+		this->hashOfPath[canonical] = hash;
+		this->entries[key] = entry;
+		return entry.texture;
+	}
+
+	// Drop unreferenced textures, least recently used first, until under budget
+	void trim() {
+		size_t total = this->getMemory();
+		while (total > this->budget) {
+			std::unordered_map<uint64_t, Entry>::iterator oldest = this->entries.end();
+			for (std::unordered_map<uint64_t, Entry>::iterator it = this->entries.begin(); it != this->entries.end(); it++) {
+				if (evictable(it->second) && (oldest == this->entries.end() || it->second.lastUse < oldest->second.lastUse)) {
+					oldest = it;
+				}
+			}
+			if (oldest == this->entries.end()) {
+				return;
+			}
+
+			total -= oldest->second.texture->getMemory();
+			for (size_t i = 0; i < oldest->second.paths.size(); i++) {
+				this->hashOfPath.erase(oldest->second.paths[i]);
+			}
+			this->entries.erase(oldest);
+		}
+	}
+
+	// Shared 1x1 grey texture, made on first use
+	std::shared_ptr<Texture> getPlaceholder() {
+		if (!this->placeholder) {
+			this->placeholder = std::make_shared<Texture>(GL_TEXTURE_2D);
+			this->placeholder->setSampler(this->sampler);
+		}
+		return this->placeholder;
+	}
+
+	// Setters
+	void setBudget(size_t budget) {
+		this->budget = budget;
+	}
+
+	// Getters
+	size_t getMemory() const {
+		size_t total = 0;
+		for (std::unordered_map<uint64_t, Entry>::const_iterator it = this->entries.begin(); it != this->entries.end(); it++) {
+			total += it->second.texture->getMemory();
+		}
+		return total;
+	}
+
+	inline size_t getBudget() const {
+		return this->budget;
+	}
+
+	inline size_t size() const {
+		return this->entries.size();
+	}
+};
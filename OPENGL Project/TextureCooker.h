@@ -0,0 +1,290 @@
+#pragma once
+
+#include<iostream>
+#include<fstream>
+#include<string>
+#include<vector>
+#include<iterator>
+#include<algorithm>
+#include<cstdint>
+#include<cstdlib>
+#include<cstring>
+
+#include<glew.h>
+#include<SOIL2.h>
+
+// DDS_header and its flags
+extern "C" {
+#include<image_DXT.h>
+}
+
+#include"ThreadPool.h"
+#include"DxtCompressor.h"
+
+// What a texture is sampled for, decides its compressed format
+enum TextureUsage {
+	TEXTURE_DIFFUSE = 0,	// BC1, or BC3 when the image has alpha
+	TEXTURE_SPECULAR = 1	// BC4 single channel, swizzled to grey when sampled
+};
+
+// Block compressed image with its whole mip chain
+struct CookedImage {
+	GLenum format;
+	int width;
+	int height;
+	std::vector<std::vector<unsigned char>> levels;
+
+	size_t getSize() const {
+		size_t size = 0;
+		for (size_t i = 0; i < this->levels.size(); i++) {
+			size += this->levels[i].size();
+		}
+		return size;
+	}
+};
+
+// Converts source images into block compressed DDS files with precomputed mipmaps
+// The cooked file sits next to the source (wood.jpg -> wood.jpg.dds, wood.jpg.spec.dds)
+// and stores the hash of the source bytes, a changed source is cooked again
+class TextureCooker {
+public:
+	// Bump when the cooked output changes so old files are rebuilt
+	enum : uint32_t {
+		VERSION = 2,
+		MAGIC = 0x444E4C42 // "BLND" in dwReserved1, marks files written here
+	};
+
+private:
+	static uint32_t fourCC(char a, char b, char c, char d) {
+		return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+	}
+
+	static int blockBytes(GLenum format) {
+		return format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? 16 : 8;
+	}
+
+	static bool hasAlpha(const unsigned char* rgba, int width, int height) {
+		for (int i = 0; i < width * height; i++) {
+			if (rgba[i * 4 + 3] != 255) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Halve an RGBA8 image with a 2x2 box filter, odd edges reuse their last texel
+	static void downsample(const std::vector<unsigned char>& source, int width, int height, std::vector<unsigned char>& target) {
+		int targetWidth = width > 1 ? width / 2 : 1;
+		int targetHeight = height > 1 ? height / 2 : 1;
+		target.resize(static_cast<size_t>(targetWidth) * targetHeight * 4);
+
+		for (int y = 0; y < targetHeight; y++) {
+			int y0 = std::min(y * 2, height - 1);
+			int y1 = std::min(y * 2 + 1, height - 1);
+			for (int x = 0; x < targetWidth; x++) {
+				int x0 = std::min(x * 2, width - 1);
+				int x1 = std::min(x * 2 + 1, width - 1);
+				for (int c = 0; c < 4; c++) {
+					int sum = source[(y0 * width + x0) * 4 + c] + source[(y0 * width + x1) * 4 + c]
+						+ source[(y1 * width + x0) * 4 + c] + source[(y1 * width + x1) * 4 + c];
+					target[(y * targetWidth + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+				}
+			}
+		}
+	}
+
+public:
+	// FNV-1a 64 bit, identifies source contents
+	static uint64_t hashBytes(const unsigned char* bytes, size_t size) {
+		uint64_t hash = 14695981039346656037ULL;
+		for (size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	static std::string cookedPath(const std::string& source, TextureUsage usage) {
+		return source + (usage == TEXTURE_SPECULAR ? ".spec.dds" : ".dds");
+	}
+
+	// Compress an RGBA8 image with a full mip chain down to 1x1
+	// Blocks of each level are spread over pool when given
+	static void cook(const unsigned char* rgba, int width, int height, TextureUsage usage, CookedImage& image,
+		DxtQuality quality = DXT_NORMAL, ThreadPool* pool = NULL) {
+		if (usage == TEXTURE_SPECULAR) {
+			image.format = GL_COMPRESSED_RED_RGTC1;
+		}
+		else {
+			image.format = hasAlpha(rgba, width, height) ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		}
+		image.width = width;
+		image.height = height;
+		image.levels.clear();
+
+		std::vector<unsigned char> level(rgba, rgba + static_cast<size_t>(width) * height * 4);
+		std::vector<unsigned char> next;
+		int levelWidth = width;
+		int levelHeight = height;
+		while (true) {
+			image.levels.push_back(std::vector<unsigned char>());
+			DxtCompressor::compress(level.data(), levelWidth, levelHeight, image.format, quality, image.levels.back(), pool);
+
+			if (levelWidth == 1 && levelHeight == 1) {
+				break;
+			}
+			downsample(level, levelWidth, levelHeight, next);
+			level.swap(next);
+			levelWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+			levelHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+		}
+	}
+
+	// Read a cooked file, fails if it is missing, foreign, outdated or cooked from other source bytes
+	// Sizes in the header are checked against the file first, so a corrupt file is cooked again instead of allocated
+	static bool load(const std::string& path, uint64_t sourceHash, CookedImage& image) {
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file.is_open()) {
+			return false;
+		}
+		uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+		file.seekg(0);
+
+		DDS_header header;
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+			return false;
+		}
+		uint64_t hash = static_cast<uint64_t>(header.dwReserved1[0]) | (static_cast<uint64_t>(header.dwReserved1[1]) << 32);
+		if (header.dwMagic != fourCC('D', 'D', 'S', ' ') || header.dwReserved1[2] != MAGIC
+			|| header.dwReserved1[3] != VERSION || hash != sourceHash) {
+			return false;
+		}
+
+		uint32_t format = header.sPixelFormat.dwFourCC;
+		if (format == fourCC('D', 'X', 'T', '1')) {
+			image.format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		}
+		else if (format == fourCC('D', 'X', 'T', '5')) {
+			image.format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		}
+		else if (format == fourCC('B', 'C', '4', 'U')) {
+			image.format = GL_COMPRESSED_RED_RGTC1;
+		}
+		else {
+			return false;
+		}
+
+		// Full or partial mip chain, at most down to 1x1, that fits in the file
+		uint64_t width = header.dwWidth;
+		uint64_t height = header.dwHeight;
+		unsigned maxLevels = 1;
+		while ((std::max(width, height) >> maxLevels) > 0) {
+			maxLevels++;
+		}
+		if (width == 0 || height == 0 || width > 0x7FFFFFFF || height > 0x7FFFFFFF
+			|| header.dwMipMapCount == 0 || header.dwMipMapCount > maxLevels) {
+			return false;
+		}
+		std::vector<uint64_t> sizes(header.dwMipMapCount);
+		uint64_t total = 0;
+		for (unsigned level = 0; level < header.dwMipMapCount; level++) {
+			uint64_t levelWidth = width >> level > 0 ? width >> level : 1;
+			uint64_t levelHeight = height >> level > 0 ? height >> level : 1;
+			sizes[level] = ((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * blockBytes(image.format);
+			total += sizes[level];
+		}
+		if (total > fileSize - sizeof(header)) {
+			return false;
+		}
+
+		image.width = static_cast<int>(width);
+		image.height = static_cast<int>(height);
+		image.levels.resize(header.dwMipMapCount);
+		for (unsigned level = 0; level < header.dwMipMapCount; level++) {
+			image.levels[level].resize(static_cast<size_t>(sizes[level]));
+			if (!file.read(reinterpret_cast<char*>(image.levels[level].data()), sizes[level])) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static bool save(const std::string& path, uint64_t sourceHash, const CookedImage& image) {
+		DDS_header header;
+		memset(&header, 0, sizeof(header));
+		header.dwMagic = fourCC('D', 'D', 'S', ' ');
+		header.dwSize = 124;
+		header.dwFlags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+		header.dwWidth = image.width;
+		header.dwHeight = image.height;
+		header.dwPitchOrLinearSize = static_cast<unsigned>(image.levels[0].size());
+		header.dwMipMapCount = static_cast<unsigned>(image.levels.size());
+		header.dwReserved1[0] = static_cast<unsigned>(sourceHash);
+		header.dwReserved1[1] = static_cast<unsigned>(sourceHash >> 32);
+		header.dwReserved1[2] = MAGIC;
+		header.dwReserved1[3] = VERSION;
+		header.sPixelFormat.dwSize = 32;
+		header.sPixelFormat.dwFlags = DDPF_FOURCC;
+		if (image.format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT) {
+			header.sPixelFormat.dwFourCC = fourCC('D', 'X', 'T', '1');
+		}
+		else if (image.format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) {
+			header.sPixelFormat.dwFourCC = fourCC('D', 'X', 'T', '5');
+		}
+		else {
+			header.sPixelFormat.dwFourCC = fourCC('B', 'C', '4', 'U');
+		}
+		header.sCaps.dwCaps1 = DDSCAPS_TEXTURE | DDSCAPS_MIPMAP | DDSCAPS_COMPLEX;
+
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			std::cout << "ERROR : TextureCooker::save - Could not write " << path << std::endl;
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		for (size_t level = 0; level < image.levels.size(); level++) {
+			file.write(reinterpret_cast<const char*>(image.levels[level].data()), image.levels[level].size());
+		}
+		return file.good();
+	}
+
+	// Cooked image for source bytes, read from the cache file or cooked and written to it
+	static bool loadOrCook(const std::string& source, const std::vector<unsigned char>& bytes, TextureUsage usage, CookedImage& image,
+		DxtQuality quality = DXT_NORMAL, ThreadPool* pool = NULL) {
+		uint64_t hash = hashBytes(bytes.data(), bytes.size());
+		std::string path = cookedPath(source, usage);
+		if (load(path, hash, image)) {
+			return true;
+		}
+
+		int width, height;
+		unsigned char* rgba = SOIL_load_image_from_memory(bytes.data(), static_cast<int>(bytes.size()), &width, &height, NULL, SOIL_LOAD_RGBA);
+		if (!rgba) {
+			return false;
+		}
+		cook(rgba, width, height, usage, image, quality, pool);
+		SOIL_free_image_data(rgba);
+
+		save(path, hash, image);
+		return true;
+	}
+
+	// Offline entry point, cooks one file on disk
+	static bool cookFile(const std::string& source, TextureUsage usage, DxtQuality quality = DXT_NORMAL, ThreadPool* pool = NULL) {
+		std::ifstream file(source, std::ios::binary);
+		if (!file.is_open()) {
+			std::cout << "ERROR : TextureCooker::cookFile - Could not read " << source << std::endl;
+			return false;
+		}
+		std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		CookedImage image;
+		if (!loadOrCook(source, bytes, usage, image, quality, pool)) {
+			std::cout << "ERROR : TextureCooker::cookFile - Could not decode " << source << std::endl;
+			return false;
+		}
+		std::cout << "Cooked " << source << " -> " << cookedPath(source, usage) << " (" << image.levels.size() << " levels, "
+			<< image.getSize() << " bytes)" << std::endl;
+		return true;
+	}
+};
@@ -0,0 +1,215 @@
+#pragma once
+
+#include<iostream>
+#include<string>
+#include<vector>
+#include<deque>
+#include<mutex>
+#include<cstring>
+
+#include<glew.h>
+#include<glfw3.h>
+#include<SOIL2.h>
+
+#include"ThreadPool.h"
+#include"Texture.h"
+#include"TextureCooker.h"
+
+// Decoded image waiting for its upload, either RGBA8 pixels or a cooked mip chain
+struct DecodedImage {
+	Texture* texture;
+	std::string fileName;
+	unsigned char* pixels;
+	int width;
+	int height;
+	CookedImage cooked;
+};
+
+// Loads textures in the background
+// Images are decoded (or their cooked files read) on a worker pool, then copied on the main thread into a ring of
+// persistently mapped pixel unpack buffers and uploaded from there. Each ring slot is
+// guarded by a fence so a slot is only rewritten once the GPU has read it.
+// Textures keep their placeholder until the upload is done
+class TextureStreamer {
+public:
+	enum : GLsizeiptr {
+		RING_SLOTS = 3,
+		// Large enough for a 2048 x 1024 RGBA8 image, bigger ones are uploaded from client memory
+		SLOT_SIZE = 8 * 1024 * 1024
+	};
+
+private:
+	ThreadPool* pool;
+
+	// Filled by the workers
+	std::mutex mutex;
+	std::deque<DecodedImage> decoded;
+
+	// Owned by the main thread
+	std::deque<DecodedImage> ready;
+	GLuint PBO;
+	unsigned char* mapped;
+	GLsync fences[RING_SLOTS];
+	unsigned nextSlot;
+	size_t pending;
+
+	// Returns false if the slot is still being read by the GPU
+	bool acquireSlot(unsigned slot) {
+		if (this->fences[slot] == 0) {
+			return true;
+		}
+		GLenum status = glClientWaitSync(this->fences[slot], 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+			return false;
+		}
+		glDeleteSync(this->fences[slot]);
+		this->fences[slot] = 0;
+		return true;
+	}
+
+public:
+	// Constructor
+	TextureStreamer(unsigned threads = 0) {
+		this->pool = new ThreadPool(threads);
+		this->nextSlot = 0;
+		this->pending = 0;
+		for (unsigned i = 0; i < RING_SLOTS; i++) {
+			this->fences[i] = 0;
+		}
+
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glGenBuffers(1, &this->PBO);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, this->PBO);
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, RING_SLOTS * SLOT_SIZE, NULL, flags);
+		this->mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, RING_SLOTS * SLOT_SIZE, flags));
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		if (!this->mapped) {
+			std::cout << "ERROR : TextureStreamer::TextureStreamer - Could not map upload ring, uploading from client memory" << std::endl;
+		}
+	}
+
+	// Destructor, waits for running decodes and drops whatever was not uploaded
+	~TextureStreamer() {
+		delete this->pool;
+
+		this->ready.insert(this->ready.end(), this->decoded.begin(), this->decoded.end());
+		for (size_t i = 0; i < this->ready.size(); i++) {
+			SOIL_free_image_data(this->ready[i].pixels);
+		}
+
+		for (unsigned i = 0; i < RING_SLOTS; i++) {
+			if (this->fences[i]) {
+				glDeleteSync(this->fences[i]);
+			}
+		}
+		if (this->mapped) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, this->PBO);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		glDeleteBuffers(1, &this->PBO);
+	}
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// Queue fileName to be decoded into texture, texture must outlive the streamer or the upload
+	void load(Texture* texture, const char* fileName) {
+		this->pending++;
+
+		std::string name(fileName);
+		this->pool->submit([this, texture, name]() {
+			DecodedImage image;
+			image.texture = texture;
+			image.fileName = name;
+			image.pixels = SOIL_load_image(name.c_str(), &image.width, &image.height, NULL, SOIL_LOAD_RGBA);
+
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->decoded.push_back(image);
+		});
+	}
+
+	// Load the cooked version of fileName from the file already read into memory
+	// The cooked file is read if it matches the bytes, otherwise it is cooked and written first
+	void loadCooked(Texture* texture, const std::string& fileName, std::vector<unsigned char> bytes, TextureUsage usage) {
+		this->pending++;
+
+		this->pool->submit([this, texture, fileName, usage, bytes = std::move(bytes)]() {
+			DecodedImage image;
+			image.texture = texture;
+			image.fileName = fileName;
+			image.pixels = NULL;
+			if (!TextureCooker::loadOrCook(fileName, bytes, usage, image.cooked)) {
+				image.cooked.levels.clear();
+			}
+
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->decoded.push_back(image);
+		});
+	}
+
+	// Upload decoded images, call once per frame on the main thread
+	// Stops early when the next ring slot is still in flight, the rest waits for the next frame
+	void update() {
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->ready.insert(this->ready.end(), this->decoded.begin(), this->decoded.end());
+			this->decoded.clear();
+		}
+
+		while (!this->ready.empty()) {
+			DecodedImage& image = this->ready.front();
+
+			bool compressed = !image.cooked.levels.empty();
+			if (!image.pixels && !compressed) {
+				std::cout << "ERROR : TextureStreamer::update - Could not load texture " << image.fileName << std::endl;
+			}
+			else {
+				GLsizeiptr size = compressed ? static_cast<GLsizeiptr>(image.cooked.getSize()) : static_cast<GLsizeiptr>(image.width) * image.height * 4;
+				if (!this->mapped || size > SLOT_SIZE) {
+					if (compressed) {
+						image.texture->uploadCompressed(image.cooked);
+					}
+					else {
+						image.texture->upload(image.width, image.height, image.pixels);
+					}
+				}
+				else {
+					unsigned slot = this->nextSlot;
+					if (!this->acquireSlot(slot)) {
+						break;
+					}
+					GLintptr offset = slot * SLOT_SIZE;
+
+					glBindBuffer(GL_PIXEL_UNPACK_BUFFER, this->PBO);
+					if (compressed) {
+						// Levels back to back in the slot
+						GLintptr levelOffset = offset;
+						for (size_t level = 0; level < image.cooked.levels.size(); level++) {
+							std::memcpy(this->mapped + levelOffset, image.cooked.levels[level].data(), image.cooked.levels[level].size());
+							levelOffset += image.cooked.levels[level].size();
+						}
+						image.texture->uploadCompressed(image.cooked, offset);
+					}
+					else {
+						std::memcpy(this->mapped + offset, image.pixels, static_cast<size_t>(size));
+						image.texture->upload(image.width, image.height, reinterpret_cast<const void*>(offset));
+					}
+					glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+					this->fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+					this->nextSlot = (slot + 1) % RING_SLOTS;
+				}
+				SOIL_free_image_data(image.pixels);
+			}
+
+			this->ready.pop_front();
+			this->pending--;
+		}
+	}
+
+	// Number of loads not uploaded yet
+	inline size_t getPending() const {
+		return this->pending;
+	}
+};
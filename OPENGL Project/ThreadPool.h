@@ -0,0 +1,103 @@
+#pragma once
+
+#include<vector>
+#include<queue>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<functional>
+#include<algorithm>
+
+// Fixed set of worker threads running queued jobs in submission order
+// Jobs must not touch OpenGL, the context only lives on the main thread
+class ThreadPool {
+private:
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping;
+
+	void work() {
+		while (true) {
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(this->mutex);
+				this->wake.wait(lock, [this] { return this->stopping || !this->jobs.empty(); });
+				if (this->jobs.empty()) {
+					return;
+				}
+				job = std::move(this->jobs.front());
+				this->jobs.pop();
+			}
+			job();
+		}
+	}
+
+public:
+	// Constructor, zero threads means one less than the hardware threads (at least one)
+	ThreadPool(unsigned threads = 0) {
+		this->stopping = false;
+		if (threads == 0) {
+			unsigned hardware = std::thread::hardware_concurrency();
+			threads = hardware > 1 ? hardware - 1 : 1;
+		}
+		for (unsigned i = 0; i < threads; i++) {
+			this->workers.push_back(std::thread(&ThreadPool::work, this));
+		}
+	}
+
+	// Destructor, finishes the queued jobs before joining
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->stopping = true;
+		}
+		this->wake.notify_all();
+		for (size_t i = 0; i < this->workers.size(); i++) {
+			this->workers[i].join();
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void submit(std::function<void()> job) {
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->jobs.push(std::move(job));
+		}
+		this->wake.notify_one();
+	}
+
+	// Split [0, count) into chunks run on the workers, returns when all are done
+	// Must not be called from a job of this same pool, it would wait on itself
+	void parallelFor(size_t count, std::function<void(size_t begin, size_t end)> body) {
+		if (count == 0) {
+			return;
+		}
+		size_t chunks = std::min(count, this->workers.size() * 4);
+		size_t remaining = chunks;
+		std::mutex doneMutex;
+		std::condition_variable done;
+
+		for (size_t chunk = 0; chunk < chunks; chunk++) {
+			size_t begin = count * chunk / chunks;
+			size_t end = count * (chunk + 1) / chunks;
+			this->submit([begin, end, &body, &remaining, &doneMutex, &done]() {
+				body(begin, end);
+				std::lock_guard<std::mutex> lock(doneMutex);
+				if (--remaining == 0) {
+					done.notify_one();
+				}
+			});
+		}
+
+		std::unique_lock<std::mutex> lock(doneMutex);
+		done.wait(lock, [&remaining] { return remaining == 0; });
+	}
+
+	inline size_t getThreadCount() const {
+		return this->workers.size();
+	}
+};
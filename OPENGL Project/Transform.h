@@ -0,0 +1,366 @@
+#pragma once
+
+#include<vector>
+#include<cmath>
+#include<cstdint>
+#include<cstring>
+#include<cstdlib>
+
+#include<glm.hpp>
+#include<vec3.hpp>
+#include<mat4x4.hpp>
+#include<gtc/type_ptr.hpp>
+
+// SSE2 is part of every x64 target and of x86 builds with /arch:SSE2 or higher
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_SIMD 1
+#include<emmintrin.h>
+#else
+#define TRANSFORM_SIMD 0
+#endif
+
+// Fixed size array aligned for SIMD loads and stores
+template<typename T>
+class AlignedArray {
+private:
+	T* items;
+	size_t count;
+
+	static T* allocate(size_t count) {
+		if (count == 0) {
+			return nullptr;
+		}
+#if TRANSFORM_SIMD
+		return static_cast<T*>(_mm_malloc(count * sizeof(T), 32));
+#else
+		return static_cast<T*>(std::malloc(count * sizeof(T)));
+#endif
+	}
+
+	static void release(T* items) {
+#if TRANSFORM_SIMD
+		_mm_free(items);
+#else
+		std::free(items);
+#endif
+	}
+
+public:
+	// Constructor
+	AlignedArray() {
+		this->items = nullptr;
+		this->count = 0;
+	}
+
+	// Destructor
+	~AlignedArray() {
+		release(this->items);
+	}
+
+	AlignedArray(const AlignedArray&) = delete;
+	AlignedArray& operator=(const AlignedArray&) = delete;
+
+	// Grow keeping existing items, new items are zeroed
+	void resize(size_t count) {
+		T* grown = allocate(count);
+		if (this->items) {
+			std::memcpy(grown, this->items, (count < this->count ? count : this->count) * sizeof(T));
+		}
+		if (count > this->count) {
+			std::memset(grown + this->count, 0, (count - this->count) * sizeof(T));
+		}
+		release(this->items);
+		this->items = grown;
+		this->count = count;
+	}
+
+	inline T& operator[](size_t i) {
+		return this->items[i];
+	}
+
+	inline const T& operator[](size_t i) const {
+		return this->items[i];
+	}
+
+	inline T* data() {
+		return this->items;
+	}
+
+	inline size_t size() const {
+		return this->count;
+	}
+};
+
+// Structure of arrays store for every mesh transform
+// Position, Euler rotation in degrees (applied X then Y then Z) and scale live in separate
+// contiguous arrays; world matrices are composed four at a time with SSE when any of the four changed
+class TransformStore {
+public:
+	typedef uint32_t Handle;
+
+private:
+	static const size_t LANES = 4;
+
+	AlignedArray<float> positionX, positionY, positionZ;
+	AlignedArray<float> rotationX, rotationY, rotationZ;
+	AlignedArray<float> scaleX, scaleY, scaleZ;
+	AlignedArray<uint8_t> dirty;
+	AlignedArray<glm::mat4> world;
+
+	size_t count;
+	std::vector<Handle> freeHandles;
+	bool anyDirty;
+
+	// Handles rebuilt by the last update
+	std::vector<Handle> updated;
+
+	void grow() {
+		size_t capacity = this->world.size() ? this->world.size() * 2 : 64;
+		this->positionX.resize(capacity);
+		this->positionY.resize(capacity);
+		this->positionZ.resize(capacity);
+		this->rotationX.resize(capacity);
+		this->rotationY.resize(capacity);
+		this->rotationZ.resize(capacity);
+		this->scaleX.resize(capacity);
+		this->scaleY.resize(capacity);
+		this->scaleZ.resize(capacity);
+		this->dirty.resize(capacity);
+		this->world.resize(capacity);
+	}
+
+	inline void markDirty(Handle handle) {
+		this->dirty[handle] = 1;
+		this->anyDirty = true;
+	}
+
+	// Compose T * Rx * Ry * Rz * S for LANES transforms starting at first
+	void composeBatch(size_t first) {
+		float cx[LANES], sx[LANES], cy[LANES], sy[LANES], cz[LANES], sz[LANES];
+		for (size_t lane = 0; lane < LANES; lane++) {
+			float x = glm::radians(this->rotationX[first + lane]);
+			float y = glm::radians(this->rotationY[first + lane]);
+			float z = glm::radians(this->rotationZ[first + lane]);
+			cx[lane] = std::cos(x); sx[lane] = std::sin(x);
+			cy[lane] = std::cos(y); sy[lane] = std::sin(y);
+			cz[lane] = std::cos(z); sz[lane] = std::sin(z);
+		}
+
+#if TRANSFORM_SIMD
+		__m128 vcx = _mm_loadu_ps(cx), vsx = _mm_loadu_ps(sx);
+		__m128 vcy = _mm_loadu_ps(cy), vsy = _mm_loadu_ps(sy);
+		__m128 vcz = _mm_loadu_ps(cz), vsz = _mm_loadu_ps(sz);
+		__m128 scx = _mm_load_ps(&this->scaleX[first]);
+		__m128 scy = _mm_load_ps(&this->scaleY[first]);
+		__m128 scz = _mm_load_ps(&this->scaleZ[first]);
+		__m128 zero = _mm_setzero_ps();
+
+		// Rotation rows, lane i belongs to transform first + i
+		__m128 sxsy = _mm_mul_ps(vsx, vsy);
+		__m128 cxsy = _mm_mul_ps(vcx, vsy);
+		__m128 r00 = _mm_mul_ps(vcy, vcz);
+		__m128 r01 = _mm_sub_ps(zero, _mm_mul_ps(vcy, vsz));
+		__m128 r02 = vsy;
+		__m128 r10 = _mm_add_ps(_mm_mul_ps(vcx, vsz), _mm_mul_ps(sxsy, vcz));
+		__m128 r11 = _mm_sub_ps(_mm_mul_ps(vcx, vcz), _mm_mul_ps(sxsy, vsz));
+		__m128 r12 = _mm_sub_ps(zero, _mm_mul_ps(vsx, vcy));
+		__m128 r20 = _mm_sub_ps(_mm_mul_ps(vsx, vsz), _mm_mul_ps(cxsy, vcz));
+		__m128 r21 = _mm_add_ps(_mm_mul_ps(vsx, vcz), _mm_mul_ps(cxsy, vsz));
+		__m128 r22 = _mm_mul_ps(vcx, vcy);
+
+		// Matrix columns across lanes, transposed into one column per transform
+		__m128 c0x = _mm_mul_ps(r00, scx), c0y = _mm_mul_ps(r10, scx), c0z = _mm_mul_ps(r20, scx), c0w = zero;
+		__m128 c1x = _mm_mul_ps(r01, scy), c1y = _mm_mul_ps(r11, scy), c1z = _mm_mul_ps(r21, scy), c1w = zero;
+		__m128 c2x = _mm_mul_ps(r02, scz), c2y = _mm_mul_ps(r12, scz), c2z = _mm_mul_ps(r22, scz), c2w = zero;
+		__m128 c3x = _mm_load_ps(&this->positionX[first]);
+		__m128 c3y = _mm_load_ps(&this->positionY[first]);
+		__m128 c3z = _mm_load_ps(&this->positionZ[first]);
+		__m128 c3w = _mm_set1_ps(1.f);
+
+		_MM_TRANSPOSE4_PS(c0x, c0y, c0z, c0w);
+		_MM_TRANSPOSE4_PS(c1x, c1y, c1z, c1w);
+		_MM_TRANSPOSE4_PS(c2x, c2y, c2z, c2w);
+		_MM_TRANSPOSE4_PS(c3x, c3y, c3z, c3w);
+
+		__m128 columns[LANES][4] = {
+			{ c0x, c1x, c2x, c3x },
+			{ c0y, c1y, c2y, c3y },
+			{ c0z, c1z, c2z, c3z },
+			{ c0w, c1w, c2w, c3w }
+		};
+		for (size_t lane = 0; lane < LANES; lane++) {
+			float* out = glm::value_ptr(this->world[first + lane]);
+			_mm_store_ps(out, columns[lane][0]);
+			_mm_store_ps(out + 4, columns[lane][1]);
+			_mm_store_ps(out + 8, columns[lane][2]);
+			_mm_store_ps(out + 12, columns[lane][3]);
+		}
+#else
+		for (size_t lane = 0; lane < LANES; lane++) {
+			size_t i = first + lane;
+			float r00 = cy[lane] * cz[lane];
+			float r01 = -cy[lane] * sz[lane];
+			float r02 = sy[lane];
+			float r10 = cx[lane] * sz[lane] + sx[lane] * sy[lane] * cz[lane];
+			float r11 = cx[lane] * cz[lane] - sx[lane] * sy[lane] * sz[lane];
+			float r12 = -sx[lane] * cy[lane];
+			float r20 = sx[lane] * sz[lane] - cx[lane] * sy[lane] * cz[lane];
+			float r21 = sx[lane] * cz[lane] + cx[lane] * sy[lane] * sz[lane];
+			float r22 = cx[lane] * cy[lane];
+
+			glm::mat4& m = this->world[i];
+			m[0] = glm::vec4(r00, r10, r20, 0.f) * this->scaleX[i];
+			m[1] = glm::vec4(r01, r11, r21, 0.f) * this->scaleY[i];
+			m[2] = glm::vec4(r02, r12, r22, 0.f) * this->scaleZ[i];
+			m[3] = glm::vec4(this->positionX[i], this->positionY[i], this->positionZ[i], 1.f);
+		}
+#endif
+	}
+
+public:
+	// Constructor
+	TransformStore() {
+		this->count = 0;
+		this->anyDirty = false;
+	}
+
+	// Destructor
+	~TransformStore() {
+
+	}
+
+	// Position, Euler degrees and scale that compose back into matrix, shear is dropped
+	// Mirroring matrices get a negative x scale
+	static void decompose(const glm::mat4& matrix, glm::vec3& position, glm::vec3& rotation, glm::vec3& scale) {
+		position = glm::vec3(matrix[3]);
+		scale = glm::vec3(glm::length(glm::vec3(matrix[0])), glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2])));
+		if (glm::determinant(glm::mat3(matrix)) < 0.f) {
+			scale.x = -scale.x;
+		}
+
+		// Rotation rows as in composeBatch
+		glm::vec3 column0 = scale.x != 0.f ? glm::vec3(matrix[0]) / scale.x : glm::vec3(1.f, 0.f, 0.f);
+		glm::vec3 column1 = scale.y != 0.f ? glm::vec3(matrix[1]) / scale.y : glm::vec3(0.f, 1.f, 0.f);
+		glm::vec3 column2 = scale.z != 0.f ? glm::vec3(matrix[2]) / scale.z : glm::vec3(0.f, 0.f, 1.f);
+		float r00 = column0.x, r01 = column1.x, r02 = column2.x;
+		float r11 = column1.y, r12 = column2.y;
+		float r21 = column1.z, r22 = column2.z;
+
+		float y = std::asin(glm::clamp(r02, -1.f, 1.f));
+		float x, z;
+		if (std::fabs(r02) < 0.99999f) {
+			x = std::atan2(-r12, r22);
+			z = std::atan2(-r01, r00);
+		}
+		else {
+			// Gimbal lock, X and Z turn about the same axis
+			x = std::atan2(r21, r11);
+			z = 0.f;
+		}
+		rotation = glm::degrees(glm::vec3(x, y, z));
+	}
+
+	// New transform slot, reuses released slots first
+	Handle create(const glm::vec3& position = glm::vec3(0.f), const glm::vec3& rotation = glm::vec3(0.f), const glm::vec3& scale = glm::vec3(1.f)) {
+		Handle handle;
+		if (!this->freeHandles.empty()) {
+			handle = this->freeHandles.back();
+			this->freeHandles.pop_back();
+		}
+		else {
+			// Keep capacity a multiple of LANES, the batch kernel never reads past it
+			if (this->count == this->world.size()) {
+				this->grow();
+			}
+			handle = static_cast<Handle>(this->count++);
+		}
+		this->setPosition(handle, position);
+		this->setRotation(handle, rotation);
+		this->setScale(handle, scale);
+		this->markDirty(handle);
+		return handle;
+	}
+
+	// Free slot for reuse
+	void release(Handle handle) {
+		this->dirty[handle] = 0;
+		this->freeHandles.push_back(handle);
+	}
+
+	// Recompose every group of LANES transforms that has at least one dirty member
+	// Returns without touching the arrays when nothing changed
+	void update() {
+		this->updated.clear();
+		if (!this->anyDirty) {
+			return;
+		}
+		for (size_t first = 0; first < this->count; first += LANES) {
+			uint32_t group;
+			std::memcpy(&group, &this->dirty[first], sizeof(group));
+			if (group == 0) {
+				continue;
+			}
+			this->composeBatch(first);
+			for (size_t lane = 0; lane < LANES; lane++) {
+				if (this->dirty[first + lane]) {
+					this->updated.push_back(static_cast<Handle>(first + lane));
+				}
+			}
+			std::memset(&this->dirty[first], 0, LANES);
+		}
+		this->anyDirty = false;
+	}
+
+	// Setters
+	void setPosition(Handle handle, const glm::vec3& position) {
+		this->positionX[handle] = position.x;
+		this->positionY[handle] = position.y;
+		this->positionZ[handle] = position.z;
+		this->markDirty(handle);
+	}
+
+	void setRotation(Handle handle, const glm::vec3& rotation) {
+		this->rotationX[handle] = rotation.x;
+		this->rotationY[handle] = rotation.y;
+		this->rotationZ[handle] = rotation.z;
+		this->markDirty(handle);
+	}
+
+	void setScale(Handle handle, const glm::vec3& scale) {
+		this->scaleX[handle] = scale.x;
+		this->scaleY[handle] = scale.y;
+		this->scaleZ[handle] = scale.z;
+		this->markDirty(handle);
+	}
+
+	// Getters
+	glm::vec3 getPosition(Handle handle) const {
+		return glm::vec3(this->positionX[handle], this->positionY[handle], this->positionZ[handle]);
+	}
+
+	glm::vec3 getRotation(Handle handle) const {
+		return glm::vec3(this->rotationX[handle], this->rotationY[handle], this->rotationZ[handle]);
+	}
+
+	glm::vec3 getScale(Handle handle) const {
+		return glm::vec3(this->scaleX[handle], this->scaleY[handle], this->scaleZ[handle]);
+	}
+
+	// World matrix as of the last update
+	const glm::mat4& getWorld(Handle handle) const {
+		return this->world[handle];
+	}
+
+	// Handles whose world matrix changed in the last update
+	const std::vector<Handle>& getUpdated() const {
+		return this->updated;
+	}
+
+	bool isDirty(Handle handle) const {
+		return this->dirty[handle] != 0;
+	}
+
+	inline size_t size() const {
+		return this->count;
+	}
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include<glew.h>
+#include<glfw3.h>
+#include<glm.hpp>
+#include<vec4.hpp>
+#include<mat4x4.hpp>
+
+// Fixed uniform and storage block binding points shared by every shader program
+enum UniformBinding {
+	FRAME_DATA_BINDING = 0,
+	MATERIAL_DATA_BINDING = 1
+};
+
+// Per-frame data, mirrors the std140 FrameData block in the shaders
+// vec3 values are stored as vec4 to match std140 alignment
+struct FrameData {
+	glm::mat4 ViewMatrix;
+	glm::mat4 ProjectionMatrix;
+	glm::vec4 camPos;
+	glm::vec4 lightPos0;
+};
+
+// Block buffer bound once to a fixed binding point, a uniform block by default
+// GL_SHADER_STORAGE_BUFFER as target backs a std430 buffer block instead
+class UniformBuffer {
+private:
+	GLuint id;
+	GLuint binding;
+	GLenum target;
+	GLsizeiptr size;
+
+public:
+	// Constructor
+	UniformBuffer(GLsizeiptr size, GLuint binding, GLenum target = GL_UNIFORM_BUFFER) {
+		this->size = size;
+		this->binding = binding;
+		this->target = target;
+
+		glGenBuffers(1, &this->id);
+		glBindBuffer(this->target, this->id);
+		glBufferData(this->target, this->size, NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(this->target, 0);
+
+		// Bound once, every program reads the block from this binding point
+		glBindBufferBase(this->target, this->binding, this->id);
+	}
+
+	// Destructor
+	~UniformBuffer() {
+		glDeleteBuffers(1, &this->id);
+	}
+
+	// Upload the whole block
+	void update(const void* data) {
+		glBindBuffer(this->target, this->id);
+		glBufferSubData(this->target, 0, this->size, data);
+		glBindBuffer(this->target, 0);
+	}
+
+	// Getters
+	inline GLuint getId() const {
+		return this->id;
+	}
+
+	inline GLuint getBinding() const {
+		return this->binding;
+	}
+};
@@ -1,6 +1,8 @@
 #pragma once
 
+#include<glew.h>
 #include<glm.hpp>
+#include<mat4x4.hpp>
 
 struct Vertex
 {
@@ -9,3 +11,28 @@ struct Vertex
 	glm::vec2 texcoord;
 	glm::vec3 normal;
 };
+
+// Per-instance data, read from the instance stream with divisor 1
+struct InstanceData
+{
+	glm::mat4 ModelMatrix;
+	GLuint ObjectId;
+	GLuint MaterialIndex;
+};
+
+// Vertex buffer binding indices used by every VAO
+enum VertexBinding {
+	VERTEX_BINDING = 0,
+	INSTANCE_BINDING = 1,
+	// First of the bindings used by geometry read from separate, non interleaved streams
+	STREAM_BINDING = 2
+};
+
+// First attribute location of the per-instance model matrix (uses 4 locations)
+const unsigned INSTANCE_MODEL_LOCATION = 4;
+
+// Attribute location of the per-instance object id written by the picking pass
+const unsigned INSTANCE_ID_LOCATION = 8;
+
+// Attribute location of the per-instance index into the material block
+const unsigned INSTANCE_MATERIAL_LOCATION = 9;
@@ -0,0 +1,170 @@
+#pragma once
+
+#include<vector>
+#include<string>
+#include<cmath>
+#include<cstring>
+#include<cstddef>
+
+#include<glew.h>
+#include<glm.hpp>
+#include<gtc/packing.hpp>
+
+#include"Vertex.h"
+
+// Vertex attribute locations, match the layout(location) of vertex_core.glsl
+enum VertexLocation {
+	POSITION_LOCATION = 0,
+	COLOR_LOCATION = 1,
+	TEXCOORD_LOCATION = 2,
+	NORMAL_LOCATION = 3
+};
+
+// GPU vertex formats, Vertex is only the import format
+// FULL          : float3 position, float3 color, float2 texcoord, float3 normal, 44 bytes
+// COMPACT       : float3 position, half2 texcoord, octahedral normal in 2_10_10_10, 20 bytes, no color
+// COMPACT_COLOR : COMPACT with an unorm8 x4 color, 24 bytes
+enum VertexFormat {
+	VERTEX_FORMAT_FULL,
+	VERTEX_FORMAT_COMPACT,
+	VERTEX_FORMAT_COMPACT_COLOR
+};
+
+// Format every geometry is converted to unless told otherwise
+// The vertex shader reads every format, it tells packed normals from float ones by w
+const VertexFormat DEFAULT_VERTEX_FORMAT = VERTEX_FORMAT_COMPACT;
+
+// One attribute of the vertex stream
+struct VertexAttribute {
+	GLuint location;
+	GLint size;
+	GLenum type;
+	GLboolean normalized;
+	GLuint offset;
+};
+
+// Descriptor of a vertex format, sets up VAO attributes and converts Vertex data into it
+// Attributes missing from a layout are disabled, shaders read their constant default
+class VertexLayout {
+private:
+	VertexFormat format;
+	std::vector<VertexAttribute> attributes;
+	GLuint stride;
+
+	void add(GLuint location, GLint size, GLenum type, GLboolean normalized, GLuint bytes) {
+		VertexAttribute attribute = { location, size, type, normalized, this->stride };
+		this->attributes.push_back(attribute);
+		this->stride += bytes;
+	}
+
+	// Snorm value in 10 bits
+	static GLuint packSnorm10(float value) {
+		float clamped = value < -1.f ? -1.f : (value > 1.f ? 1.f : value);
+		int quantized = static_cast<int>(std::floor(clamped * 511.f + 0.5f));
+		return static_cast<GLuint>(quantized) & 0x3FF;
+	}
+
+	static float signNotZero(float value) {
+		return value >= 0.f ? 1.f : -1.f;
+	}
+
+public:
+	// Constructor
+	VertexLayout(VertexFormat format = DEFAULT_VERTEX_FORMAT) {
+		this->format = format;
+		this->stride = 0;
+
+		this->add(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, 12);
+		if (format == VERTEX_FORMAT_FULL) {
+			this->add(COLOR_LOCATION, 3, GL_FLOAT, GL_FALSE, 12);
+			this->add(TEXCOORD_LOCATION, 2, GL_FLOAT, GL_FALSE, 8);
+			this->add(NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, 12);
+			return;
+		}
+		if (format == VERTEX_FORMAT_COMPACT_COLOR) {
+			this->add(COLOR_LOCATION, 4, GL_UNSIGNED_BYTE, GL_TRUE, 4);
+		}
+		this->add(TEXCOORD_LOCATION, 2, GL_HALF_FLOAT, GL_FALSE, 4);
+		this->add(NORMAL_LOCATION, 4, GL_INT_2_10_10_10_REV, GL_TRUE, 4);
+	}
+
+	// Unit normal folded onto the octahedron and unwrapped to [-1, 1]^2, packed as snorm 10 in x and y
+	// w stays 0, which tells the vertex shader the normal is packed
+	static GLuint encodeOctahedral(const glm::vec3& normal) {
+		float length = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+		glm::vec2 encoded = length > 0.f ? glm::vec2(normal.x, normal.y) / length : glm::vec2(0.f);
+		if (length > 0.f && normal.z < 0.f) {
+			encoded = glm::vec2((1.f - std::fabs(encoded.y)) * signNotZero(encoded.x),
+				(1.f - std::fabs(encoded.x)) * signNotZero(encoded.y));
+		}
+		return packSnorm10(encoded.x) | (packSnorm10(encoded.y) << 10);
+	}
+
+	// Inverse of encodeOctahedral, same math as decodeNormal in vertex_core.glsl
+	static glm::vec3 decodeOctahedral(GLuint packed) {
+		int x = static_cast<int>(packed << 22) >> 22;
+		int y = static_cast<int>(packed << 12) >> 22;
+		glm::vec2 encoded(glm::max(x / 511.f, -1.f), glm::max(y / 511.f, -1.f));
+		glm::vec3 normal(encoded.x, encoded.y, 1.f - std::fabs(encoded.x) - std::fabs(encoded.y));
+		float fold = glm::max(-normal.z, 0.f);
+		normal.x += normal.x >= 0.f ? -fold : fold;
+		normal.y += normal.y >= 0.f ? -fold : fold;
+		return glm::normalize(normal);
+	}
+
+	// Point the attributes of the bound VAO at binding, the buffer itself is bound separately
+	void apply(GLuint binding) const {
+		for (size_t i = 0; i < this->attributes.size(); i++) {
+			const VertexAttribute& attribute = this->attributes[i];
+			glVertexAttribFormat(attribute.location, attribute.size, attribute.type, attribute.normalized, attribute.offset);
+			glVertexAttribBinding(attribute.location, binding);
+			glEnableVertexAttribArray(attribute.location);
+		}
+	}
+
+	// Convert count import vertices into this format, stride bytes each
+	void encode(const Vertex* vertices, size_t count, std::vector<unsigned char>& out) const {
+		out.resize(count * this->stride);
+		unsigned char* target = out.data();
+		for (size_t i = 0; i < count; i++, target += this->stride) {
+			const Vertex& vertex = vertices[i];
+			if (this->format == VERTEX_FORMAT_FULL) {
+				std::memcpy(target, &vertex.position, 12);
+				std::memcpy(target + 12, &vertex.color, 12);
+				std::memcpy(target + 24, &vertex.texcoord, 8);
+				std::memcpy(target + 32, &vertex.normal, 12);
+				continue;
+			}
+
+			unsigned char* cursor = target;
+			std::memcpy(cursor, &vertex.position, 12);
+			cursor += 12;
+			if (this->format == VERTEX_FORMAT_COMPACT_COLOR) {
+				glm::vec3 color = glm::clamp(vertex.color, 0.f, 1.f) * 255.f + 0.5f;
+				cursor[0] = static_cast<unsigned char>(color.r);
+				cursor[1] = static_cast<unsigned char>(color.g);
+				cursor[2] = static_cast<unsigned char>(color.b);
+				cursor[3] = 255;
+				cursor += 4;
+			}
+			GLuint texcoord = glm::packHalf2x16(vertex.texcoord);
+			std::memcpy(cursor, &texcoord, 4);
+			cursor += 4;
+			GLuint normal = encodeOctahedral(vertex.normal);
+			std::memcpy(cursor, &normal, 4);
+		}
+	}
+
+	// Getters
+	inline VertexFormat getFormat() const {
+		return this->format;
+	}
+
+	inline GLuint getStride() const {
+		return this->stride;
+	}
+
+	inline const std::vector<VertexAttribute>& getAttributes() const {
+		return this->attributes;
+	}
+};
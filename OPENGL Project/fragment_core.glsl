@@ -1,47 +1,94 @@
 #version 440
+#ifdef BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif
 
+// Matches MaterialData, textures holds array layers or bindless handles
 struct Material
 {
-	vec3 ambient;
-	vec3 diffuse;
-	vec3 specular;
-	sampler2D diffuseTex;
-	sampler2D specularTex;
+	vec4 ambient;
+	vec4 diffuse;
+	vec4 specular;
+	uvec4 textures;
 };
 
 in vec3 vs_position;
 in vec3 vs_color;
 in vec2 vs_texcoord;
 in vec3 vs_normal;
+flat in uint vs_materialIndex;
 
 out vec4 fs_color;
 
-uniform	Material material;
+layout (std140, binding = 0) uniform FrameData
+{
+	mat4 ViewMatrix;
+	mat4 ProjectionMatrix;
+	vec4 camPos;
+	vec4 lightPos0;
+};
 
-uniform vec3 lightPos0;
-uniform vec3 camPos;
+#ifdef BINDLESS
+// Every material with its own texture handles, nothing is bound per draw
+layout (std430, binding = 1) readonly buffer MaterialBlock
+{
+	Material materials[];
+};
+
+vec4 sampleDiffuse(Material material, vec2 texcoord) {
+	return texture(sampler2D(material.textures.xy), texcoord);
+}
+
+vec4 sampleSpecular(Material material, vec2 texcoord) {
+	return texture(sampler2D(material.textures.zw), texcoord);
+}
+#else
+// Images packed into texture arrays, textures.x and textures.y are the layers
+layout (std140, binding = 1) uniform MaterialBlock
+{
+	Material materials[256];
+};
+
+layout (binding = 0) uniform sampler2DArray diffuseArray;
+layout (binding = 1) uniform sampler2DArray specularArray;
+
+vec4 sampleDiffuse(Material material, vec2 texcoord) {
+	return texture(diffuseArray, vec3(texcoord, material.textures.x));
+}
+
+vec4 sampleSpecular(Material material, vec2 texcoord) {
+	return texture(specularArray, vec3(texcoord, material.textures.y));
+}
+#endif
+
+Material material;
+vec2 texcoord;
 
 vec3 calculateDiffuseLight() {
-	vec3 posToLight = normalize(lightPos0 - vs_position);
-	vec3 diffuseColor = material.diffuse;
+	vec3 posToLight = normalize(lightPos0.xyz - vs_position);
+	vec3 diffuseColor = material.diffuse.rgb;
 	float diffuse = clamp(dot(posToLight, vs_normal), 0, 1);
 	vec3 diffuseLight = diffuseColor * diffuse;
 	return diffuseLight;
 }
 
 vec3 calculateSpecularLight() {
-	vec3 lightToPos = normalize(vs_position - lightPos0);
+	vec3 lightToPos = normalize(vs_position - lightPos0.xyz);
 	vec3 reflectDir = normalize(reflect(lightToPos, normalize(vs_normal)));
-	vec3 posToView = normalize(camPos - vs_position);
+	vec3 posToView = normalize(camPos.xyz - vs_position);
 	float specular = pow(max(dot(posToView, reflectDir), 0), 50);
-	vec3 specularLight = material.specular * specular * texture(material.specularTex, vs_texcoord).rgb;
+	vec3 specularLight = material.specular.rgb * specular * sampleSpecular(material, texcoord).rgb;
 	return specularLight;
 }
 
 void main() {
-	vec3 ambientLight = material.ambient;
+	material = materials[vs_materialIndex];
+	// The vertex shader flips v for bottom left origins, undone for materials with top left ones
+	texcoord = material.ambient.w > 0.5f ? vec2(vs_texcoord.x, -vs_texcoord.y) : vs_texcoord;
+
+	vec3 ambientLight = material.ambient.rgb;
 	vec3 diffuseLight = calculateDiffuseLight();
 	vec3 specularLight = calculateSpecularLight();
 	vec4 light = vec4(ambientLight, 1.f) + vec4(diffuseLight, 1.f) + vec4(specularLight, 1.f);
-	fs_color = texture(material.diffuseTex, vs_texcoord) * light;
+	fs_color = sampleDiffuse(material, texcoord) * light;
 }
\ No newline at end of file
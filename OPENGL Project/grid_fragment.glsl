@@ -0,0 +1,49 @@
+#version 440
+
+layout (std140, binding = 0) uniform FrameData
+{
+	mat4 ViewMatrix;
+	mat4 ProjectionMatrix;
+	vec4 camPos;
+	vec4 lightPos0;
+};
+
+in vec3 vs_near;
+in vec3 vs_far;
+
+out vec4 fs_color;
+
+uniform float gridHeight;
+uniform float gridSpacing;
+uniform float fadeDistance;
+uniform vec3 gridColor;
+
+// Anti-aliased line coverage, lines stay one pixel wide at any distance
+float gridCoverage(vec2 coord) {
+	vec2 derivative = fwidth(coord);
+	vec2 grid = abs(fract(coord - 0.5f) - 0.5f) / derivative;
+	float line = min(grid.x, grid.y);
+	return 1.f - min(line, 1.f);
+}
+
+void main() {
+	// Intersect view ray with the ground plane
+	float t = (gridHeight - vs_near.y) / (vs_far.y - vs_near.y);
+	if (t <= 0.f) {
+		discard;
+	}
+	vec3 position = vs_near + t * (vs_far - vs_near);
+
+	// Depth of the plane so meshes occlude the grid correctly
+	vec4 clip = ProjectionMatrix * ViewMatrix * vec4(position, 1.f);
+	gl_FragDepth = (clip.z / clip.w) * 0.5f + 0.5f;
+
+	float coverage = gridCoverage(position.xz / gridSpacing);
+	float fade = 1.f - clamp(length(position.xz - camPos.xz) / fadeDistance, 0.f, 1.f);
+	float alpha = coverage * fade;
+	if (alpha <= 0.f) {
+		discard;
+	}
+
+	fs_color = vec4(gridColor, alpha);
+}
@@ -0,0 +1,35 @@
+#version 440
+
+layout (std140, binding = 0) uniform FrameData
+{
+	mat4 ViewMatrix;
+	mat4 ProjectionMatrix;
+	vec4 camPos;
+	vec4 lightPos0;
+};
+
+out vec3 vs_near;
+out vec3 vs_far;
+
+// Fullscreen triangle, no vertex buffer needed
+const vec2 corners[3] = vec2[3](
+	vec2(-1.f, -1.f),
+	vec2(3.f, -1.f),
+	vec2(-1.f, 3.f)
+);
+
+vec3 unproject(mat4 inverseViewProjection, vec2 xy, float z) {
+	vec4 point = inverseViewProjection * vec4(xy, z, 1.f);
+	return point.xyz / point.w;
+}
+
+void main() {
+	vec2 corner = corners[gl_VertexID];
+	mat4 inverseViewProjection = inverse(ProjectionMatrix * ViewMatrix);
+
+	// World space ray through this corner, interpolated per fragment
+	vs_near = unproject(inverseViewProjection, corner, -1.f);
+	vs_far = unproject(inverseViewProjection, corner, 1.f);
+
+	gl_Position = vec4(corner, 0.f, 1.f);
+}
@@ -0,0 +1,9 @@
+#version 440
+
+flat in uint vs_objectId;
+
+out uint fs_objectId;
+
+void main() {
+	fs_objectId = vs_objectId;
+}
@@ -4,6 +4,8 @@
 #include<fstream>
 #include<string>
 #include<vector>
+#include<chrono>
+#include<thread>
 
 #include<glew.h>
 #include<glfw3.h>
@@ -16,6 +18,20 @@
 #include<gtc/type_ptr.hpp>
 #include<SOIL2.h>
 
+#include"GLState.h"
 #include"Camera.h"
+#include"Bvh.h"
+#include"UniformBuffer.h"
+#include"Transform.h"
+#include"TextureStreamer.h"
+#include"TextureCache.h"
+#include"MaterialLibrary.h"
 #include"Mesh.h"
+#include"Instancing.h"
+#include"RenderQueue.h"
+#include"Picking.h"
+#include"Grid.h"
 #include"Primitives.h"
+#include"ObjModel.h"
+#include"GltfScene.h"
+#include"MeshCooker.h"
@@ -1,10 +1,61 @@
 #include"Application.h"
+#include"Benchmark.h"
+
+// Offline texture cooking : --cook [--quality fast|normal|high] <diffuse images> [--spec <specular images>]
+// Writes the block compressed .dds files the texture cache loads at startup
+static int cookTextures(int argc, char** argv) {
+	bool failed = false;
+	ThreadPool pool(std::thread::hardware_concurrency());
+	TextureUsage usage = TEXTURE_DIFFUSE;
+	DxtQuality quality = DXT_NORMAL;
+	for (int i = 2; i < argc; i++) {
+		std::string argument(argv[i]);
+		if (argument == "--spec") {
+			usage = TEXTURE_SPECULAR;
+		}
+		else if (argument == "--quality" && i + 1 < argc) {
+			std::string level(argv[++i]);
+			quality = level == "fast" ? DXT_FAST : (level == "high" ? DXT_HIGH : DXT_NORMAL);
+		}
+		else {
+			// One file at a time, the blocks of each level use every core
+			failed = !TextureCooker::cookFile(argument, usage, quality, &pool) || failed;
+		}
+	}
+	return failed ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+	if (argc > 1 && std::string(argv[1]) == "--cook") {
+		return cookTextures(argc, argv);
+	}
+	if (argc > 1 && std::string(argv[1]) == "--bench-dxt") {
+		return Benchmark::dxt(argc > 2 ? argv[2] : "Images/metal.jpg");
+	}
+	if (argc > 1 && std::string(argv[1]) == "--bench-meshopt") {
+		return Benchmark::meshopt();
+	}
+
+	if (argc > 2 && std::string(argv[1]) == "--bench-obj") {
+		return Benchmark::obj(argv[2]);
+	}
 
-int main() {	
 	Application app("Blander 0.1b", 640, 480, true);
+	if (argc > 1 && std::string(argv[1]) == "--bench-textures") {
+		app.benchmarkTextures();
+		return 0;
+	}
+
+	// Model files given on the command line are placed in the scene
+	for (int i = 1; i < argc; i++) {
+		if (argv[i][0] != '-' && !app.importModel(argv[i])) {
+			std::cout << "ERROR : main - Could not import " << argv[i] << std::endl;
+		}
+	}
+
 	while (!app.getWindowShouldClose()) {
 		app.update();
 		app.render();
 	}
 	return 0;
-}
\ No newline at end of file
+}
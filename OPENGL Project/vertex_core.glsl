@@ -3,22 +3,46 @@
 layout (location = 0) in vec3 vertex_position;
 layout (location = 1) in vec3 vertex_color;
 layout (location = 2) in vec2 vertex_texcoord;
-layout (location = 3) in vec3 vertex_normal;
+layout (location = 3) in vec4 vertex_normal;
+layout (location = 4) in mat4 ModelMatrix;
+layout (location = 8) in uint ObjectId;
+layout (location = 9) in uint MaterialIndex;
 
 out vec3 vs_position;
 out vec3 vs_color;
 out vec2 vs_texcoord;
 out vec3 vs_normal;
+flat out uint vs_objectId;
+flat out uint vs_materialIndex;
 
-uniform mat4 ModelMatrix;
-uniform mat4 ViewMatrix;
-uniform mat4 ProjectionMatrix;
+// Packed normals are folded onto the octahedron with xy in [-1, 1] and w = 0
+// Float normals have three components, w reads the default 1 and they are used as is
+vec3 decodeNormal(vec4 encoded) {
+	if (encoded.w != 0.f) {
+		return encoded.xyz;
+	}
+	vec3 normal = vec3(encoded.xy, 1.f - abs(encoded.x) - abs(encoded.y));
+	float fold = max(-normal.z, 0.f);
+	normal.x += normal.x >= 0.f ? -fold : fold;
+	normal.y += normal.y >= 0.f ? -fold : fold;
+	return normalize(normal);
+}
+
+layout (std140, binding = 0) uniform FrameData
+{
+	mat4 ViewMatrix;
+	mat4 ProjectionMatrix;
+	vec4 camPos;
+	vec4 lightPos0;
+};
 
 void main() {
 	vs_position = vec4(ModelMatrix * vec4(vertex_position, 1.f)).xyz;
 	vs_color = vertex_color;
 	vs_texcoord = vec2(vertex_texcoord.x, vertex_texcoord.y * -1.f);
-	vs_normal = mat3(ModelMatrix) * vertex_normal;
+	vs_normal = mat3(ModelMatrix) * decodeNormal(vertex_normal);
+	vs_objectId = ObjectId;
+	vs_materialIndex = MaterialIndex;
 
 	//gl_Position = vec4(vertex_position, 1.f);
 	gl_Position = ProjectionMatrix * ViewMatrix * ModelMatrix * vec4(vertex_position, 1.f);